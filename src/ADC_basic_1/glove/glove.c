@@ -0,0 +1,96 @@
+/*****************************************************************************
+* File Name:   glove.c
+*
+* Description: Glove scan loop body, independent of the board.
+******************************************************************************/
+
+#include <stdio.h>
+
+#include "glove.h"
+#include "glove_hal.h"
+#include "glove_linearize.h"
+
+void glove_init(glove_t *glove)
+{
+    glove->settings.scan_period_us = ADC_SCAN_DELAY_MS * 1000u;
+    glove->settings.average_shift = 0;
+    glove->settings.channel_mask = (1u << GLOVE_NUM_CHANNELS) - 1u;
+    glove->settings.acquisition_ns = ACQUISITION_TIME_NS;
+    glove->settings.format = GLOVE_FORMAT_FORCE;
+    glove->settings.send_timestamp = SEND_TIMESTAMP;
+    glove_hal_set_acquisition_ns(ACQUISITION_TIME_NS);
+
+    glove_baseline_init(&glove->baseline);
+    for (uint8_t i = 0; i < GLOVE_NUM_CHANNELS; i++)
+        glove->values[i] = 0;
+    glove->stamp_us = 0;
+    glove->scan_start_us = glove_hal_time_us();
+}
+
+void glove_scan(glove_t *glove)
+{
+    const glove_settings_t *settings = &glove->settings;
+
+    // The baselines track in time, whatever the scan rate
+    uint32_t start_us = glove_hal_time_us();
+    uint32_t elapsed_us = start_us - glove->scan_start_us;
+    glove->scan_start_us = start_us;
+
+    for (uint8_t i = 0; i < GLOVE_NUM_CHANNELS; i++)
+    {
+        if (!(settings->channel_mask & (1u << i)))
+        {
+            glove->values[i] = 0;
+            continue;
+        }
+
+        // Power-of-two averaging keeps the path free of division
+        uint32_t sum = 0;
+        for (uint8_t n = 0; n < (1u << settings->average_shift); n++)
+            sum += glove_hal_read_counts(i);
+        uint16_t counts = (uint16_t)(sum >> settings->average_shift);
+
+        if (settings->format == GLOVE_FORMAT_RAW)
+            glove->values[i] = counts;
+        else
+            glove->values[i] = glove_baseline_update(&glove->baseline, i, glove_linearize(counts), elapsed_us);
+    }
+
+    // Stamp once every conversion of this scan is done, before any UART output
+    glove->stamp_us = glove_hal_time_us();
+
+    char line[GLOVE_LINE_SIZE];
+    size_t len = glove_format_line(glove, line, sizeof(line));
+    glove_hal_write(line, len);
+}
+
+void glove_wait_period(const glove_t *glove, uint32_t start_us)
+{
+    uint32_t elapsed_us = glove_hal_time_us() - start_us;
+    if (elapsed_us < glove->settings.scan_period_us)
+        glove_hal_delay_us(glove->settings.scan_period_us - elapsed_us);
+}
+
+size_t glove_line_max_size(bool send_timestamp)
+{
+    // "%6ld" per channel, commas between them, ",<10 digits>" and "\r\n"
+    size_t len = GLOVE_NUM_CHANNELS * 7u - 1u + 2u;
+    return send_timestamp ? len + 11u : len;
+}
+
+size_t glove_format_line(const glove_t *glove, char *line, size_t size)
+{
+    size_t len = 0;
+
+    for (uint8_t i = 0; i < GLOVE_NUM_CHANNELS; i++)
+    {
+        const char *format = (i < GLOVE_NUM_CHANNELS - 1) ? "%6ld," : "%6ld";
+        len += snprintf(line + len, size - len, format, (long int)glove->values[i]);
+    }
+
+    if (glove->settings.send_timestamp)
+        len += snprintf(line + len, size - len, ",%lu", (unsigned long)glove->stamp_us);
+
+    len += snprintf(line + len, size - len, "\r\n");
+    return len;
+}
@@ -0,0 +1,63 @@
+/*****************************************************************************
+* File Name:   glove.h
+*
+* Description: One scan of the glove: read every channel through the HAL,
+*              linearize it to force, remove the baselines and send a line
+*              to the host.
+******************************************************************************/
+
+#ifndef GLOVE_H
+#define GLOVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "glove_baseline.h"
+
+#define GLOVE_LINE_SIZE           (64u)
+
+typedef enum
+{
+    GLOVE_FORMAT_FORCE,     // linearized, baseline removed (cN)
+    GLOVE_FORMAT_RAW        // averaged ADC counts, for checking the hardware
+} glove_format_t;
+
+// Everything a host may change at runtime (see glove_command.h)
+typedef struct
+{
+    uint32_t       scan_period_us;      // scan start to scan start
+    uint8_t        average_shift;       // average 2^average_shift conversions
+    uint8_t        channel_mask;        // disabled channels read as 0
+    uint32_t       acquisition_ns;
+    glove_format_t format;
+    bool           send_timestamp;
+} glove_settings_t;
+
+typedef struct
+{
+    glove_settings_t settings;
+    glove_baseline_t baseline;
+    int32_t          values[GLOVE_NUM_CHANNELS];   // last scan in cN, baseline removed
+    uint32_t         stamp_us;                     // when the last scan completed
+    uint32_t         scan_start_us;                // when the last scan began
+} glove_t;
+
+// Reset the baselines and load the default settings from glove_config.h.
+void   glove_init(glove_t *glove);
+
+// Read, process and send one scan.
+void   glove_scan(glove_t *glove);
+
+// Wait out the rest of the scan period that began at start_us
+// (glove_hal_time_us()), so scans run at the configured rate however long
+// the scan, its UART output and the command handling took.
+void   glove_wait_period(const glove_t *glove, uint32_t start_us);
+
+// Longest line glove_format_line() produces, terminator included.
+size_t glove_line_max_size(bool send_timestamp);
+
+// Format the last scan as "v0,v1,v2,v3,v4[,stamp]\r\n"; returns the length.
+size_t glove_format_line(const glove_t *glove, char *line, size_t size);
+
+#endif /* GLOVE_H */
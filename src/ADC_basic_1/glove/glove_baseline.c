@@ -0,0 +1,68 @@
+/*****************************************************************************
+* File Name:   glove_baseline.c
+*
+* Description: FSRs creep and drift over a session, so the unloaded reading of
+*              every channel moves. Each channel keeps a slow exponential
+*              estimate of its unloaded level, frozen while the finger presses,
+*              and the pipeline sends readings relative to it. The step toward
+*              each reading is elapsed time / time constant, so the tracking
+*              speed does not depend on the scan rate.
+******************************************************************************/
+
+#include "glove_baseline.h"
+
+// 2^32 / time constant: the per-scan step is a multiply, no division
+#define RISE_PER_US_Q32           ((uint32_t)(0x100000000ull / BASELINE_RISE_US))
+#define FALL_PER_US_Q32           ((uint32_t)(0x100000000ull / BASELINE_FALL_US))
+
+void glove_baseline_init(glove_baseline_t *baseline)
+{
+    baseline->press_cn = BASELINE_PRESS_CN;
+    glove_baseline_reset(baseline);
+}
+
+void glove_baseline_reset(glove_baseline_t *baseline)
+{
+    for (uint8_t i = 0; i < GLOVE_NUM_CHANNELS; i++)
+    {
+        baseline->level_q16[i] = 0;
+        baseline->primed[i] = false;
+    }
+}
+
+int32_t glove_baseline_update(glove_baseline_t *baseline, uint8_t channel, int32_t force_cn,
+                              uint32_t elapsed_us)
+{
+    int32_t *level = &baseline->level_q16[channel];
+    int32_t sample_q16 = force_cn * 65536;
+
+    if (!baseline->primed[channel])
+    {
+        // First reading after reset: assume the finger is unloaded
+        *level = sample_q16;
+        baseline->primed[channel] = true;
+        return 0;
+    }
+
+    int32_t delta = force_cn - (*level >> 16);
+    if (delta > baseline->press_cn)
+        return delta;   // pressed: hold the baseline
+
+    // Step of elapsed / time constant (Q16), at most the whole way
+    bool falling = sample_q16 < *level;
+    uint32_t tau_us = falling ? BASELINE_FALL_US : BASELINE_RISE_US;
+    if (elapsed_us > tau_us)
+        elapsed_us = tau_us;
+    uint32_t alpha_q16 = (uint32_t)(((uint64_t)elapsed_us * (falling ? FALL_PER_US_Q32 : RISE_PER_US_Q32)) >> 16);
+    if (alpha_q16 > 65536u)
+        alpha_q16 = 65536u;
+    *level += (int32_t)(((int64_t)(sample_q16 - *level) * (int32_t)alpha_q16) >> 16);
+
+    delta = force_cn - (*level >> 16);
+    return delta > 0 ? delta : 0;
+}
+
+int32_t glove_baseline_level(const glove_baseline_t *baseline, uint8_t channel)
+{
+    return baseline->level_q16[channel] >> 16;
+}
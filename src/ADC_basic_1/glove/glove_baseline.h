@@ -0,0 +1,34 @@
+/*****************************************************************************
+* File Name:   glove_baseline.h
+*
+* Description: Per-channel baseline tracker for the force sensing resistors.
+******************************************************************************/
+
+#ifndef GLOVE_BASELINE_H
+#define GLOVE_BASELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glove_config.h"
+
+typedef struct
+{
+    int32_t level_q16[GLOVE_NUM_CHANNELS];  // baseline in cN, 16 fractional bits
+    bool    primed[GLOVE_NUM_CHANNELS];
+    int32_t press_cn;                       // above the baseline by this much = pressed
+} glove_baseline_t;
+
+void    glove_baseline_init(glove_baseline_t *baseline);
+
+// Forget the tracked levels; the next reading of each channel becomes its baseline.
+void    glove_baseline_reset(glove_baseline_t *baseline);
+
+// Feed one raw reading taken elapsed_us after the previous one; returns it
+// with the baseline removed (never negative).
+int32_t glove_baseline_update(glove_baseline_t *baseline, uint8_t channel, int32_t force_cn,
+                              uint32_t elapsed_us);
+
+int32_t glove_baseline_level(const glove_baseline_t *baseline, uint8_t channel);
+
+#endif /* GLOVE_BASELINE_H */
@@ -0,0 +1,199 @@
+/*****************************************************************************
+* File Name:   glove_command.c
+*
+* Description: Parser and handlers of the UART RX command channel.
+******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "glove_command.h"
+#include "glove_hal.h"
+
+#define GLOVE_REPLY_SIZE          (96u)
+
+void glove_command_init(glove_command_t *command)
+{
+    command->len = 0;
+    command->overflow = false;
+}
+
+// Decimal, or hex after an explicit 0x (a leading 0 is not octal). No sign,
+// nothing after the digits, and nothing that does not fit 32 bits.
+static bool parse_uint(const char *text, uint32_t *value)
+{
+    if (text == NULL || *text == '\0')
+        return false;
+
+    uint32_t base = 10u;
+    if (text[0] == '0' && text[1] == 'X')
+    {
+        base = 16u;
+        text += 2;
+        if (*text == '\0')
+            return false;
+    }
+
+    uint64_t parsed = 0;
+    for (; *text != '\0'; text++)
+    {
+        uint32_t digit;
+        if (*text >= '0' && *text <= '9')
+            digit = (uint32_t)(*text - '0');
+        else if (base == 16u && *text >= 'A' && *text <= 'F')
+            digit = (uint32_t)(*text - 'A') + 10u;
+        else
+            return false;
+        parsed = parsed * base + digit;
+        if (parsed > UINT32_MAX)
+            return false;
+    }
+    *value = (uint32_t)parsed;
+    return true;
+}
+
+// Highest scan rate whose lines fit through the UART, 10 bits per byte
+static uint32_t link_max_rate_hz(bool send_timestamp)
+{
+    return GLOVE_UART_BAUD / (10u * (uint32_t)glove_line_max_size(send_timestamp));
+}
+
+static size_t reply_ok(const glove_t *glove, const char *name, char *reply, size_t size)
+{
+    const glove_settings_t *settings = &glove->settings;
+    return snprintf(reply, size, "#OK %s PERIOD_US %lu AVG %u CH 0x%02X THR %ld ACQ %lu FMT %s TS %u\r\n",
+                    name, (unsigned long)settings->scan_period_us, 1u << settings->average_shift,
+                    settings->channel_mask, (long)glove->baseline.press_cn,
+                    (unsigned long)settings->acquisition_ns,
+                    settings->format == GLOVE_FORMAT_RAW ? "RAW" : "FORCE",
+                    settings->send_timestamp ? 1u : 0u);
+}
+
+static size_t reply_error(const char *name, const char *reason, char *reply, size_t size)
+{
+    return snprintf(reply, size, "#ERR %s %s\r\n", name, reason);
+}
+
+size_t glove_command_execute(glove_t *glove, char *line, char *reply, size_t size)
+{
+    glove_settings_t *settings = &glove->settings;
+
+    for (char *c = line; *c != '\0'; c++)
+    {
+        if (*c >= 'a' && *c <= 'z')
+            *c -= 'a' - 'A';
+    }
+
+    char *name = strtok(line, " \t");
+    if (name == NULL)
+        return 0;
+    char *arg = strtok(NULL, " \t");
+    if (strtok(NULL, " \t") != NULL)
+        return reply_error(name, "too many arguments", reply, size);
+    uint32_t value = 0;
+    bool has_value = parse_uint(arg, &value);
+
+    if (strcmp(name, "RATE") == 0)
+    {
+        if (!has_value || value < 1u || value > GLOVE_MAX_RATE_HZ)
+            return reply_error(name, "expects 1..1000 Hz", reply, size);
+        if (value > link_max_rate_hz(settings->send_timestamp))
+            return reply_error(name, "exceeds the UART link", reply, size);
+        settings->scan_period_us = 1000000u / value;
+    }
+    else if (strcmp(name, "AVG") == 0)
+    {
+        uint8_t shift = 0;
+        while (shift <= GLOVE_MAX_AVERAGE_SHIFT && (1u << shift) != value)
+            shift++;
+        if (!has_value || shift > GLOVE_MAX_AVERAGE_SHIFT)
+            return reply_error(name, "expects 1, 2, 4, 8 or 16", reply, size);
+        settings->average_shift = shift;
+    }
+    else if (strcmp(name, "CH") == 0)
+    {
+        if (!has_value || value == 0u || value >= (1u << GLOVE_NUM_CHANNELS))
+            return reply_error(name, "expects a mask of channels 0..4", reply, size);
+        settings->channel_mask = (uint8_t)value;
+    }
+    else if (strcmp(name, "THR") == 0)
+    {
+        if (!has_value || value < 1u || value > 1000u)
+            return reply_error(name, "expects 1..1000 cN", reply, size);
+        glove->baseline.press_cn = (int32_t)value;
+    }
+    else if (strcmp(name, "ACQ") == 0)
+    {
+        if (!has_value || value < 100u || value > 100000u)
+            return reply_error(name, "expects 100..100000 ns", reply, size);
+        settings->acquisition_ns = value;
+        glove_hal_set_acquisition_ns(value);
+    }
+    else if (strcmp(name, "FMT") == 0)
+    {
+        if (arg != NULL && strcmp(arg, "FORCE") == 0)
+            settings->format = GLOVE_FORMAT_FORCE;
+        else if (arg != NULL && strcmp(arg, "RAW") == 0)
+            settings->format = GLOVE_FORMAT_RAW;
+        else
+            return reply_error(name, "expects FORCE or RAW", reply, size);
+        glove_baseline_reset(&glove->baseline);
+    }
+    else if (strcmp(name, "TS") == 0)
+    {
+        if (!has_value || value > 1u)
+            return reply_error(name, "expects 0 or 1", reply, size);
+        if (1000000u / settings->scan_period_us > link_max_rate_hz(value != 0u))
+            return reply_error(name, "exceeds the UART link at this RATE", reply, size);
+        settings->send_timestamp = value != 0u;
+    }
+    else if (strcmp(name, "ZERO") == 0)
+    {
+        if (arg != NULL)
+            return reply_error(name, "too many arguments", reply, size);
+        glove_baseline_reset(&glove->baseline);
+    }
+    else if (strcmp(name, "GET") == 0)
+    {
+        if (arg != NULL)
+            return reply_error(name, "too many arguments", reply, size);
+    }
+    else
+    {
+        return reply_error(name, "unknown command", reply, size);
+    }
+
+    return reply_ok(glove, name, reply, size);
+}
+
+void glove_command_poll(glove_command_t *command, glove_t *glove)
+{
+    int c;
+
+    while ((c = glove_hal_read_char()) >= 0)
+    {
+        if (c != '\r' && c != '\n')
+        {
+            if (command->len < GLOVE_COMMAND_SIZE)
+                command->line[command->len++] = (char)c;
+            else
+                command->overflow = true;
+            continue;
+        }
+
+        char reply[GLOVE_REPLY_SIZE];
+        size_t len = 0;
+        if (command->overflow)
+        {
+            len = reply_error("?", "line too long", reply, sizeof(reply));
+        }
+        else
+        {
+            command->line[command->len] = '\0';
+            len = glove_command_execute(glove, command->line, reply, sizeof(reply));
+        }
+        if (len > 0)
+            glove_hal_write(reply, len);
+        glove_command_init(command);
+    }
+}
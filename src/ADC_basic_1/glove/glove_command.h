@@ -0,0 +1,52 @@
+/*****************************************************************************
+* File Name:   glove_command.h
+*
+* Description: Line commands from the host on UART RX, so a session can trade
+*              latency against noise without reflashing. One command per line,
+*              case-insensitive, at most one argument, numbers in decimal
+*              or 0x hex (a leading 0 is still decimal):
+*
+*                RATE <hz>        scans per second (1..1000, and no more lines
+*                                 than GLOVE_UART_BAUD carries)
+*                AVG <n>          conversions averaged per channel (1, 2, 4, 8, 16)
+*                CH <mask>        enabled channels, bit 0 = channel 0
+*                THR <cN>         press threshold that freezes the baseline
+*                ACQ <ns>         ADC acquisition time
+*                FMT FORCE|RAW    send force in cN or averaged raw counts
+*                TS 0|1           append the scan timestamp (refused when the
+*                                 longer lines would not fit the current RATE)
+*                ZERO             re-learn every baseline
+*                GET              report the current settings
+*
+*              Every line is answered with "#OK <command> <settings>" or
+*              "#ERR <command> <reason>"; the leading '#' keeps replies apart
+*              from data lines. PERIOD_US in the settings is the time from
+*              one scan start to the next.
+******************************************************************************/
+
+#ifndef GLOVE_COMMAND_H
+#define GLOVE_COMMAND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "glove.h"
+
+typedef struct
+{
+    char    line[GLOVE_COMMAND_SIZE + 1];
+    uint8_t len;
+    bool    overflow;
+} glove_command_t;
+
+void   glove_command_init(glove_command_t *command);
+
+// Drain the received bytes; run and answer every complete line. Never blocks.
+void   glove_command_poll(glove_command_t *command, glove_t *glove);
+
+// Run one command line (terminator removed, modified in place) and write the
+// reply into reply; returns the reply length, 0 for an empty line.
+size_t glove_command_execute(glove_t *glove, char *line, char *reply, size_t size);
+
+#endif /* GLOVE_COMMAND_H */
@@ -0,0 +1,47 @@
+/*****************************************************************************
+* File Name:   glove_config.h
+*
+* Description: Compile-time settings of the glove sensor pipeline, shared by
+*              the board build and the host simulator. The scan rate,
+*              averaging, channels, press threshold and output format are
+*              only defaults; hosts can change them at runtime over UART RX
+*              (glove_command.c).
+******************************************************************************/
+
+#ifndef GLOVE_CONFIG_H
+#define GLOVE_CONFIG_H
+
+#define GLOVE_NUM_CHANNELS        (5u)
+#define GLOVE_ADC_BITS            (12u)
+#define ACQUISITION_TIME_NS       (1000u)
+#define ADC_SCAN_DELAY_MS         (50u)     // default scan period
+#define GLOVE_MAX_RATE_HZ         (1000u)
+
+// UART to the host (KitProg3 bridge), 8N1 = 10 bits per byte on the wire.
+// RATE is refused when the lines would not fit through it.
+#define GLOVE_UART_BAUD           (115200u)
+#define GLOVE_MAX_AVERAGE_SHIFT   (4u)      // average up to 16 conversions per channel
+
+// Longest command line accepted on UART RX, terminator excluded
+#define GLOVE_COMMAND_SIZE        (32u)
+
+// Append the scan's conversion timestamp (microseconds, free-running 32-bit
+// counter) as a 6th field so the host can measure ADC-to-sound latency.
+// Set to 0 to start with the plain 5-field output (TS 1 turns it on later).
+#define SEND_TIMESTAMP            (1u)
+#define TIMESTAMP_FREQ_HZ         (1000000u)
+
+// Readings are sent as force in centinewtons: raw counts go through the FSR
+// linearization table generated by tools/gen_fsr_lut.py (glove/fsr_lut.h).
+
+// Baseline tracking. A channel more than BASELINE_PRESS_CN above its baseline
+// is being pressed and its baseline is frozen. While unloaded, upward drift
+// (FSR creep) is followed with a time constant of BASELINE_RISE_US and
+// downward drift, e.g. a sensor relaxing after a long press, with
+// BASELINE_FALL_US. The constants are in time, not scans, so RATE does not
+// change how fast a slowly rising press is absorbed.
+#define BASELINE_PRESS_CN         (15)
+#define BASELINE_RISE_US          (3200000u)
+#define BASELINE_FALL_US          (400000u)
+
+#endif /* GLOVE_CONFIG_H */
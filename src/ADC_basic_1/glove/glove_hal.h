@@ -0,0 +1,35 @@
+/*****************************************************************************
+* File Name:   glove_hal.h
+*
+* Description: Thin hardware layer under the glove pipeline. The board build
+*              implements it with cyhal (glove_hal_psoc6.c), the host build
+*              with simulated sensors (host/glove_hal_sim.c).
+******************************************************************************/
+
+#ifndef GLOVE_HAL_H
+#define GLOVE_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bring up the ADC (and the timestamp timer). Halts on failure.
+void     glove_hal_init(void);
+
+// One conversion of the given input, raw counts (GLOVE_ADC_BITS wide).
+uint16_t glove_hal_read_counts(uint8_t channel);
+
+// Minimum sampling time of the following conversions.
+void     glove_hal_set_acquisition_ns(uint32_t ns);
+
+// Free-running microsecond counter, wraps at 2^32.
+uint32_t glove_hal_time_us(void);
+
+// Send bytes to the host over the UART.
+void     glove_hal_write(const char *data, size_t len);
+
+// Next byte received from the host, or -1 when none is waiting. Never blocks.
+int      glove_hal_read_char(void);
+
+void     glove_hal_delay_us(uint32_t us);
+
+#endif /* GLOVE_HAL_H */
@@ -0,0 +1,20 @@
+/*****************************************************************************
+* File Name:   glove_linearize.c
+*
+* Description: Lookup into the generated FSR table.
+******************************************************************************/
+
+#include "glove_config.h"
+#include "glove_linearize.h"
+#include "fsr_lut.h"
+
+#if FSR_LUT_BITS != GLOVE_ADC_BITS
+#error "fsr_lut.h was generated for a different ADC resolution (tools/gen_fsr_lut.py --bits)"
+#endif
+
+int32_t glove_linearize(uint16_t counts)
+{
+    // An over-range reading is full force, not a wrap back to the bottom of the table
+    const uint16_t last = (1u << GLOVE_ADC_BITS) - 1u;
+    return fsr_lut[counts > last ? last : counts];
+}
@@ -0,0 +1,19 @@
+/*****************************************************************************
+* File Name:   glove_linearize.h
+*
+* Description: FSR counts to force. Voltage across the divider is far from
+*              linear in force, so every reading goes through a table built
+*              at compile time from the divider and sensor curve parameters
+*              (tools/gen_fsr_lut.py); no arithmetic per sample.
+******************************************************************************/
+
+#ifndef GLOVE_LINEARIZE_H
+#define GLOVE_LINEARIZE_H
+
+#include <stdint.h>
+
+// Raw ADC counts to force in centinewtons; counts past the ADC range read as
+// FSR_LUT_MAX_CN.
+int32_t glove_linearize(uint16_t counts);
+
+#endif /* GLOVE_LINEARIZE_H */
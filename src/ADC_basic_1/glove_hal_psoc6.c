@@ -0,0 +1,174 @@
+/*****************************************************************************
+* File Name:   glove_hal_psoc6.c
+*
+* Description: glove_hal.h on the PSoC6 board: one ADC shared by all inputs,
+*              UART (both directions) through retarget-io, timestamps from a
+*              1 MHz timer.
+******************************************************************************/
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "cy_pdl.h"
+#include "cyhal.h"
+#include "cybsp.h"
+#include "cy_retarget_io.h"
+
+#include "glove_config.h"
+#include "glove_hal.h"
+
+// Define ADC input pins
+static const cyhal_gpio_t input_pins[GLOVE_NUM_CHANNELS] = {P10_0, P10_1, P10_2, P10_3, P10_4};
+
+static cyhal_adc_t adc_obj;
+static uint32_t acquisition_ns = ACQUISITION_TIME_NS;
+
+// Every input gets its channel once at init. Only the one being read is
+// enabled, so a conversion samples that input alone, and averaging costs no
+// more than the conversions themselves.
+static cyhal_adc_channel_t channels[GLOVE_NUM_CHANNELS];
+static int8_t enabled_channel = -1;
+
+// Always running so a host can turn timestamps on at runtime (TS 1)
+static cyhal_timer_t stamp_timer;
+
+static const cyhal_adc_config_t adc_config = {
+    .continuous_scanning = false,
+    .average_count = 1,
+    .vref = CYHAL_ADC_REF_VDDA,
+    .vneg = CYHAL_ADC_VNEG_VSSA,
+    .resolution = GLOVE_ADC_BITS,
+    .ext_vref = NC,
+    .bypass_pin = NC
+};
+
+static void timestamp_timer_init(void)
+{
+    const cyhal_timer_cfg_t timer_cfg = {
+        .compare_value = 0,
+        .period = 0xFFFFFFFFu,
+        .direction = CYHAL_TIMER_DIR_UP,
+        .is_compare = false,
+        .is_continuous = true,
+        .value = 0
+    };
+
+    cy_rslt_t result = cyhal_timer_init(&stamp_timer, NC, NULL);
+    if (result == CY_RSLT_SUCCESS)
+        result = cyhal_timer_configure(&stamp_timer, &timer_cfg);
+    if (result == CY_RSLT_SUCCESS)
+        result = cyhal_timer_set_frequency(&stamp_timer, TIMESTAMP_FREQ_HZ);
+    if (result == CY_RSLT_SUCCESS)
+        result = cyhal_timer_start(&stamp_timer);
+
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("Timestamp timer init failed: %ld\n", (long unsigned int)result);
+        CY_ASSERT(0);
+    }
+}
+
+static void channel_configure(uint8_t channel, bool enabled)
+{
+    const cyhal_adc_channel_config_t config = {
+        .enable_averaging = false,
+        .min_acquisition_ns = acquisition_ns,
+        .enabled = enabled
+    };
+
+    cy_rslt_t result = cyhal_adc_channel_configure(&channels[channel], &config);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("ADC Channel %d config failed: %ld\n", channel, (long unsigned int)result);
+        CY_ASSERT(0);
+    }
+}
+
+void glove_hal_init(void)
+{
+    // Initialize ADC core
+    cy_rslt_t result = cyhal_adc_init(&adc_obj, input_pins[0], NULL);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("ADC init failed: %ld\n", (long unsigned int)result);
+        CY_ASSERT(0);
+    }
+
+    result = cyhal_adc_configure(&adc_obj, &adc_config);
+    if (result != CY_RSLT_SUCCESS)
+    {
+        printf("ADC config failed: %ld\n", (long unsigned int)result);
+        CY_ASSERT(0);
+    }
+
+    const cyhal_adc_channel_config_t disabled = {
+        .enable_averaging = false,
+        .min_acquisition_ns = acquisition_ns,
+        .enabled = false
+    };
+    for (uint8_t i = 0; i < GLOVE_NUM_CHANNELS; i++)
+    {
+        result = cyhal_adc_channel_init_diff(&channels[i], &adc_obj, input_pins[i], CYHAL_ADC_VNEG, &disabled);
+        if (result != CY_RSLT_SUCCESS)
+        {
+            printf("ADC Channel %d init failed: %ld\n", i, (long unsigned int)result);
+            CY_ASSERT(0);
+        }
+    }
+    enabled_channel = -1;
+
+    timestamp_timer_init();
+}
+
+uint16_t glove_hal_read_counts(uint8_t channel)
+{
+    // Switch inputs only when the channel changes: the 2^shift conversions
+    // averaged for one channel reuse the same setup
+    if (enabled_channel != (int8_t)channel)
+    {
+        if (enabled_channel >= 0)
+            channel_configure((uint8_t)enabled_channel, false);
+        channel_configure(channel, true);
+        enabled_channel = (int8_t)channel;
+    }
+
+    // 16-bit scaled result down to the 12-bit counts the FSR table is indexed by
+    return cyhal_adc_read_u16(&channels[channel]) >> (16u - GLOVE_ADC_BITS);
+}
+
+void glove_hal_set_acquisition_ns(uint32_t ns)
+{
+    // Disabled channels pick it up when they are next enabled
+    acquisition_ns = ns;
+    if (enabled_channel >= 0)
+        channel_configure((uint8_t)enabled_channel, true);
+}
+
+uint32_t glove_hal_time_us(void)
+{
+    return cyhal_timer_read(&stamp_timer);
+}
+
+void glove_hal_write(const char *data, size_t len)
+{
+    fwrite(data, 1, len, stdout);
+}
+
+int glove_hal_read_char(void)
+{
+    uint8_t c;
+
+    if (cyhal_uart_readable(&cy_retarget_io_uart_obj) == 0)
+        return -1;
+    if (cyhal_uart_getc(&cy_retarget_io_uart_obj, &c, 1u) != CY_RSLT_SUCCESS)
+        return -1;
+    return c;
+}
+
+void glove_hal_delay_us(uint32_t us)
+{
+    // cyhal_system_delay_us() takes at most 65535 us
+    if (us >= 1000u)
+        cyhal_system_delay_ms(us / 1000u);
+    cyhal_system_delay_us((uint16_t)(us % 1000u));
+}
@@ -0,0 +1,151 @@
+/*****************************************************************************
+* File Name:   glove_hal_sim.c
+*
+* Description: glove_hal.h on the host. Each channel carries a small resting
+*              load that creeps upward over the session, and a finger that
+*              presses it every 10 s (channels staggered): alternately a step
+*              held for 0.75 s and a slow press ramping up over 2 s, which a
+*              baseline tracker must not mistake for drift. The load goes
+*              through the FSR and divider model that tools/gen_fsr_lut.py
+*              assumes by default, then +/-2 counts of ADC noise. Time only
+*              advances through glove_hal_delay_us(), so a long session
+*              simulates in a fraction of a second.
+******************************************************************************/
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glove_config.h"
+#include "glove_hal_sim.h"
+
+#define SIM_REST_CN               (10)      // resting load of channel 0 (strap, glove fabric)
+#define SIM_REST_STEP_CN          (4)       // each further channel carries a little more
+#define SIM_CREEP_CN_PER_MIN      (10)      // FSR creep
+#define SIM_PRESS_CN              (500)
+#define SIM_PRESS_PERIOD_US       (10000000u)
+#define SIM_PRESS_LENGTH_US       (750000u)
+#define SIM_RAMP_LENGTH_US        (2000000u)
+#define SIM_NOISE_COUNTS          (2)
+#define SIM_RX_SIZE               (256u)
+#define SIM_TX_SIZE               (128u)
+
+// Same defaults as tools/gen_fsr_lut.py
+#define SIM_DIVIDER_OHMS          (10000.0)
+#define SIM_FSR_OHMS_1N           (10000.0)
+#define SIM_FSR_EXPONENT          (0.9)
+
+bool     glove_sim_echo = true;
+uint64_t glove_sim_bytes_written = 0;
+
+static uint64_t sim_time_us = 0;
+static uint32_t noise_state = 1;
+static char     rx_buffer[SIM_RX_SIZE];
+static size_t   rx_head = 0, rx_tail = 0;
+static char     tx_last[SIM_TX_SIZE];
+
+static int32_t sim_noise_counts(void)
+{
+    noise_state = noise_state * 1103515245u + 12345u;
+    return (int32_t)((noise_state >> 16) % (2 * SIM_NOISE_COUNTS + 1)) - SIM_NOISE_COUNTS;
+}
+
+int32_t glove_sim_rest_cn(uint8_t channel)
+{
+    int32_t creep = (int32_t)(sim_time_us * SIM_CREEP_CN_PER_MIN / 60000000u);
+    return SIM_REST_CN + channel * SIM_REST_STEP_CN + creep;
+}
+
+int32_t glove_sim_load_cn(uint8_t channel)
+{
+    // Staggered, and no finger is down at power-up
+    uint64_t offset = (uint64_t)(channel + 1) * SIM_PRESS_PERIOD_US / (GLOVE_NUM_CHANNELS + 1);
+    if (sim_time_us < offset)
+        return 0;
+    uint64_t since = sim_time_us - offset;
+    uint64_t phase = since % SIM_PRESS_PERIOD_US;
+
+    if ((since / SIM_PRESS_PERIOD_US) % 2u == 0u)
+        return phase < SIM_PRESS_LENGTH_US ? SIM_PRESS_CN : 0;
+    if (phase >= SIM_RAMP_LENGTH_US)
+        return 0;
+    return (int32_t)(SIM_PRESS_CN * phase / SIM_RAMP_LENGTH_US);
+}
+
+bool glove_sim_pressed(uint8_t channel)
+{
+    return glove_sim_load_cn(channel) > 0;
+}
+
+int32_t glove_sim_force_cn(uint8_t channel)
+{
+    return glove_sim_rest_cn(channel) + glove_sim_load_cn(channel);
+}
+
+void glove_hal_init(void)
+{
+    sim_time_us = 0;
+    noise_state = 1;
+}
+
+uint16_t glove_hal_read_counts(uint8_t channel)
+{
+    const int32_t full_scale = 1 << GLOVE_ADC_BITS;
+    double force_n = glove_sim_force_cn(channel) / 100.0;
+    double fsr_ohms = SIM_FSR_OHMS_1N / pow(force_n, SIM_FSR_EXPONENT);
+    int32_t counts = (int32_t)lround(full_scale * SIM_DIVIDER_OHMS / (SIM_DIVIDER_OHMS + fsr_ohms));
+
+    counts += sim_noise_counts();
+    if (counts < 0)
+        counts = 0;
+    if (counts > full_scale - 1)
+        counts = full_scale - 1;
+    return (uint16_t)counts;
+}
+void glove_hal_set_acquisition_ns(uint32_t ns)
+{
+    (void)ns;   // the simulated ADC settles instantly
+}
+
+void glove_sim_receive(const char *text)
+{
+    size_t len = strlen(text);
+    for (size_t i = 0; i < len && rx_tail < SIM_RX_SIZE; i++)
+        rx_buffer[rx_tail++] = text[i];
+}
+
+int glove_hal_read_char(void)
+{
+    if (rx_head == rx_tail)
+    {
+        rx_head = rx_tail = 0;
+        return -1;
+    }
+    return (unsigned char)rx_buffer[rx_head++];
+}
+
+uint32_t glove_hal_time_us(void)
+{
+    return (uint32_t)sim_time_us;
+}
+
+const char *glove_sim_last_write(void)
+{
+    return tx_last;
+}
+
+void glove_hal_write(const char *data, size_t len)
+{
+    size_t kept = len < SIM_TX_SIZE ? len : SIM_TX_SIZE - 1u;
+    memcpy(tx_last, data, kept);
+    tx_last[kept] = '\0';
+
+    glove_sim_bytes_written += len;
+    if (glove_sim_echo)
+        fwrite(data, 1, len, stdout);
+}
+
+void glove_hal_delay_us(uint32_t us)
+{
+    sim_time_us += us;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+* File Name:   glove_hal_sim.h
+*
+* Description: Simulated glove sensors for the host build. Besides
+*              glove_hal.h, the simulator exposes the ground truth so the
+*              benchmark can score the pipeline.
+******************************************************************************/
+
+#ifndef GLOVE_HAL_SIM_H
+#define GLOVE_HAL_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "glove_hal.h"
+
+// When false, glove_hal_write() only counts bytes instead of printing them.
+extern bool     glove_sim_echo;
+extern uint64_t glove_sim_bytes_written;
+
+// The last glove_hal_write(), NUL-terminated (cut to fit the buffer).
+const char *glove_sim_last_write(void);
+
+// Load on the channel when the finger is lifted, creep included (cN).
+int32_t glove_sim_rest_cn(uint8_t channel);
+
+// Load on the channel right now (cN).
+int32_t glove_sim_force_cn(uint8_t channel);
+
+// Load of the finger alone right now, 0 when lifted (cN).
+int32_t glove_sim_load_cn(uint8_t channel);
+
+// Whether the simulated finger is touching the channel right now.
+bool    glove_sim_pressed(uint8_t channel);
+
+// Queue bytes as if the host had sent them; glove_hal_read_char() returns them.
+void    glove_sim_receive(const char *text);
+
+#endif /* GLOVE_HAL_SIM_H */
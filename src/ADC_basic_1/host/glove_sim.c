@@ -0,0 +1,158 @@
+/*****************************************************************************
+* File Name:   glove_sim.c
+*
+* Description: Run the glove pipeline on the host against simulated sensors.
+*
+*              ./build/glove_sim [scans]        print every line, like the UART
+*              ./build/glove_sim -b [scans]     benchmark: time per scan and how
+*                                               well the baselines follow drift
+*              -c "<command>"                   send a command line (glove_command.h)
+*                                               before scanning, may repeat
+******************************************************************************/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "glove.h"
+#include "glove_command.h"
+#include "glove_hal_sim.h"
+
+#define DEFAULT_SCANS             (72000u)  // one hour at 50 ms
+#define WARMUP_SCANS              (20u)
+#define MAX_COMMANDS              (8u)
+
+// Reset the simulator and the glove, then deliver the command lines
+static void start(glove_t *glove, char **commands, unsigned count)
+{
+    glove_command_t command;
+
+    glove_hal_init();
+    glove_init(glove);
+    glove_command_init(&command);
+    for (unsigned i = 0; i < count; i++)
+    {
+        glove_sim_receive(commands[i]);
+        glove_sim_receive("\n");
+    }
+    glove_command_poll(&command, glove);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv)
+{
+    bool bench = false;
+    unsigned long scans = DEFAULT_SCANS;
+    char *commands[MAX_COMMANDS];
+    unsigned command_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-b") == 0)
+            bench = true;
+        else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc && command_count < MAX_COMMANDS)
+            commands[command_count++] = argv[++i];
+        else
+            scans = strtoul(argv[i], NULL, 10);
+    }
+
+    glove_t glove;
+    glove_sim_echo = !bench;
+    double busy = 0.0;
+
+    if (bench)
+    {
+        // Timing pass, nothing but the pipeline in the loop
+        start(&glove, commands, command_count);
+        double begin = now_s();
+        for (unsigned long n = 0; n < scans; n++)
+        {
+            uint32_t start_us = glove_hal_time_us();
+            glove_scan(&glove);
+            glove_wait_period(&glove, start_us);
+        }
+        busy = now_s() - begin;
+        glove_sim_bytes_written = 0;
+    }
+
+    glove_sim_echo = true;   // show the command replies
+    start(&glove, commands, command_count);
+    glove_sim_echo = !bench;
+
+    // Scores: residual on unloaded channels (should stay near the noise),
+    // readings of pressed channels, error of the tracked baselines, and how
+    // far baseline + reading is from the true load (linearization error).
+    // A reading counts as missed when the finger load is well past the press
+    // level but the output is not, e.g. a slow ramp absorbed as drift.
+    uint64_t rest_count = 0, press_count = 0, missed = 0;
+    int64_t rest_sum = 0, press_sum = 0, level_error_sum = 0, force_error_sum = 0;
+    int32_t rest_max = 0, force_error_max = 0;
+
+    for (unsigned long n = 0; n < scans; n++)
+    {
+        uint32_t start_us = glove_hal_time_us();
+        glove_scan(&glove);
+
+        if (n >= WARMUP_SCANS)
+        {
+            for (uint8_t ch = 0; ch < GLOVE_NUM_CHANNELS; ch++)
+            {
+                int32_t value = glove.values[ch];
+                if (glove_sim_pressed(ch))
+                {
+                    press_count++;
+                    press_sum += value;
+                    if (glove_sim_load_cn(ch) > 2 * glove.baseline.press_cn && value <= glove.baseline.press_cn)
+                        missed++;
+                    int32_t error = value + glove_baseline_level(&glove.baseline, ch) - glove_sim_force_cn(ch);
+                    error = error < 0 ? -error : error;
+                    force_error_sum += error;
+                    if (error > force_error_max)
+                        force_error_max = error;
+                }
+                else
+                {
+                    rest_count++;
+                    rest_sum += value;
+                    if (value > rest_max)
+                        rest_max = value;
+                    int32_t error = glove_baseline_level(&glove.baseline, ch) - glove_sim_rest_cn(ch);
+                    level_error_sum += error < 0 ? -error : error;
+                }
+            }
+        }
+
+        glove_wait_period(&glove, start_us);
+    }
+
+    if (!bench)
+        return 0;
+
+    printf("scans            %lu (%.1f simulated minutes)\n", scans,
+           scans * (glove.settings.scan_period_us / 60e6));
+    printf("time per scan    %.1f ns\n", busy / scans * 1e9);
+    printf("bytes sent       %llu (%.1f per scan)\n", (unsigned long long)glove_sim_bytes_written,
+           (double)glove_sim_bytes_written / scans);
+    if (rest_count)
+        printf("unloaded output  mean %.2f cN, max %ld cN, baseline error %.2f cN\n",
+               (double)rest_sum / rest_count, (long)rest_max, (double)level_error_sum / rest_count);
+    if (press_count)
+    {
+        printf("pressed output   mean %.1f cN, %llu of %llu missed\n",
+               (double)press_sum / press_count, (unsigned long long)missed,
+               (unsigned long long)press_count);
+        printf("force error      mean %.2f cN, max %ld cN\n",
+               (double)force_error_sum / press_count, (long)force_error_max);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*****************************************************************************
+* File Name:   test_baseline.c
+*
+* Description: Unit tests of glove_baseline.c: unloaded drift is followed at
+*              the same speed whatever the scan rate, a press freezes the
+*              baseline, and the baseline recovers after a long press.
+******************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "glove_baseline.h"
+
+#define SCAN_US                   (50000u)
+
+static int32_t distance(int32_t a, int32_t b)
+{
+    return abs(a - b);
+}
+
+// Feed force_cn to channel 0 for the given time; returns the last output
+static int32_t hold(glove_baseline_t *baseline, int32_t force_cn, uint32_t ms, uint32_t scan_us)
+{
+    int32_t value = 0;
+    for (uint32_t t = 0; t < ms * 1000u; t += scan_us)
+        value = glove_baseline_update(baseline, 0, force_cn, scan_us);
+    return value;
+}
+
+static void test_first_reading_primes(void)
+{
+    glove_baseline_t baseline;
+    glove_baseline_init(&baseline);
+
+    assert(glove_baseline_update(&baseline, 0, 120, SCAN_US) == 0);
+    assert(glove_baseline_level(&baseline, 0) == 120);
+    assert(glove_baseline_update(&baseline, 0, 125, SCAN_US) == 5);
+
+    glove_baseline_reset(&baseline);
+    assert(glove_baseline_update(&baseline, 0, 300, SCAN_US) == 0);
+    assert(glove_baseline_level(&baseline, 0) == 300);
+}
+
+// Creep of 10 cN/min for ten minutes, at 20 Hz and at 1 kHz
+static void test_creep_is_followed(void)
+{
+    const uint32_t scan_us[] = { SCAN_US, 1000u };
+
+    for (unsigned i = 0; i < sizeof(scan_us) / sizeof(scan_us[0]); i++)
+    {
+        glove_baseline_t baseline;
+        glove_baseline_init(&baseline);
+        glove_baseline_update(&baseline, 0, 100, scan_us[i]);
+
+        int32_t value = 0, force_cn = 100;
+        for (uint64_t t = 0; t < 600000000u; t += scan_us[i])
+        {
+            force_cn = 100 + (int32_t)(t / 6000000u);
+            value = glove_baseline_update(&baseline, 0, force_cn, scan_us[i]);
+            assert(value <= 2);
+        }
+        assert(value <= 1);
+        assert(distance(glove_baseline_level(&baseline, 0), force_cn) <= 1);
+    }
+}
+
+// A slow press rising 100 cN/s must not be taken for drift at any scan rate
+static void test_slow_press_is_not_absorbed(void)
+{
+    const uint32_t scan_us[] = { SCAN_US, 1000u };
+
+    for (unsigned i = 0; i < sizeof(scan_us) / sizeof(scan_us[0]); i++)
+    {
+        glove_baseline_t baseline;
+        glove_baseline_init(&baseline);
+        glove_baseline_update(&baseline, 0, 100, scan_us[i]);
+
+        int32_t value = 0;
+        for (uint32_t t = 0; t <= 3000000u; t += scan_us[i])
+            value = glove_baseline_update(&baseline, 0, 100 + (int32_t)(t / 10000u), scan_us[i]);
+        assert(value >= 280);
+        assert(glove_baseline_level(&baseline, 0) < 120);
+    }
+}
+
+static void test_press_freezes_baseline(void)
+{
+    glove_baseline_t baseline;
+    glove_baseline_init(&baseline);
+    glove_baseline_update(&baseline, 0, 100, SCAN_US);
+
+    assert(hold(&baseline, 600, 30000u, SCAN_US) == 500);
+    assert(glove_baseline_level(&baseline, 0) == 100);
+
+    // Only just above the press level still counts as pressed
+    assert(hold(&baseline, 100 + BASELINE_PRESS_CN + 1, 30000u, SCAN_US) == BASELINE_PRESS_CN + 1);
+    assert(glove_baseline_level(&baseline, 0) == 100);
+
+    // A raised threshold (THR) holds a harder press as drift
+    baseline.press_cn = 200;
+    hold(&baseline, 250, 30000u, SCAN_US);
+    assert(distance(glove_baseline_level(&baseline, 0), 250) <= 1);
+}
+
+// After a minute-long press the sensor relaxes below where it started; the
+// baseline must come down within a second or two, and no channel is touched
+// but the one pressed.
+static void test_recovers_after_long_press(void)
+{
+    glove_baseline_t baseline;
+    glove_baseline_init(&baseline);
+    glove_baseline_update(&baseline, 0, 100, SCAN_US);
+    glove_baseline_update(&baseline, 1, 50, SCAN_US);
+
+    hold(&baseline, 800, 60000u, SCAN_US);
+    assert(glove_baseline_level(&baseline, 0) == 100);
+
+    assert(hold(&baseline, 80, 2000u, SCAN_US) == 0);
+    assert(distance(glove_baseline_level(&baseline, 0), 80) <= 1);
+    assert(glove_baseline_level(&baseline, 1) == 50);
+
+    // Relaxed back up a little: followed, and reads as unloaded again
+    assert(hold(&baseline, 90, 20000u, SCAN_US) <= 1);
+    assert(distance(glove_baseline_level(&baseline, 0), 90) <= 1);
+}
+
+int main(void)
+{
+    test_first_reading_primes();
+    test_creep_is_followed();
+    test_slow_press_is_not_absorbed();
+    test_press_freezes_baseline();
+    test_recovers_after_long_press();
+    printf("test_baseline: ok\n");
+    return 0;
+}
@@ -0,0 +1,251 @@
+/*****************************************************************************
+* File Name:   test_command.c
+*
+* Description: Unit tests of glove_command.c: argument checking of every
+*              command, settings that must stay untouched on an error, format
+*              switching, and line handling of glove_command_poll().
+******************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "glove_command.h"
+#include "glove_hal_sim.h"
+
+static char reply[128];
+
+// Run one command line; returns the reply
+static const char *run(glove_t *glove, const char *text)
+{
+    char line[GLOVE_COMMAND_SIZE + 1];
+    snprintf(line, sizeof(line), "%s", text);
+    size_t len = glove_command_execute(glove, line, reply, sizeof(reply));
+    reply[len] = '\0';
+    return reply;
+}
+
+static bool starts_with(const char *text, const char *prefix)
+{
+    return strncmp(text, prefix, strlen(prefix)) == 0;
+}
+
+static void start(glove_t *glove)
+{
+    glove_sim_echo = false;
+    glove_hal_init();
+    glove_init(glove);
+}
+
+static void test_average(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    const char *bad[] = { "AVG", "AVG 0", "AVG 3", "AVG 32", "AVG -1", "AVG four", "AVG 4x" };
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert(starts_with(run(&glove, bad[i]), "#ERR AVG "));
+        assert(glove.settings.average_shift == 0);
+    }
+
+    assert(starts_with(run(&glove, "AVG 16"), "#OK AVG "));
+    assert(glove.settings.average_shift == 4);
+    assert(strstr(reply, " AVG 16 ") != NULL);
+    assert(starts_with(run(&glove, "avg 0x8"), "#OK AVG "));
+    assert(glove.settings.average_shift == 3);
+    assert(starts_with(run(&glove, "AVG 02"), "#OK AVG "));
+    assert(glove.settings.average_shift == 1);
+}
+
+// Decimal or explicit 0x hex only, 32 bits, one argument
+static void test_numbers(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    // A leading 0 is decimal, not octal
+    assert(starts_with(run(&glove, "RATE 050"), "#OK RATE PERIOD_US 20000 "));
+    assert(starts_with(run(&glove, "RATE 0X19"), "#OK RATE PERIOD_US 40000 "));
+
+    const char *bad[] = { "RATE 4294967297", "RATE 99999999999999999999", "RATE +10", "RATE -10",
+                          "RATE 0x", "RATE 0x0x10", "RATE 1e2", "RATE 0b101", "RATE 100 junk",
+                          "RATE 100 200" };
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert(starts_with(run(&glove, bad[i]), "#ERR RATE "));
+        assert(glove.settings.scan_period_us == 40000u);
+    }
+
+    assert(starts_with(run(&glove, "THR 4294967336"), "#ERR THR "));   // 2^32 + 40
+    assert(glove.baseline.press_cn == BASELINE_PRESS_CN);
+    assert(starts_with(run(&glove, "FMT RAW now"), "#ERR FMT too many arguments"));
+    assert(glove.settings.format == GLOVE_FORMAT_FORCE);
+    assert(starts_with(run(&glove, "GET all"), "#ERR GET "));
+}
+
+static void test_rate(void)
+{
+    glove_t glove;
+    start(&glove);
+    const uint32_t period_us = glove.settings.scan_period_us;
+
+    const char *bad[] = { "RATE", "RATE 0", "RATE 1001", "RATE fast", "RATE 0x", "RATE 12abc" };
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert(starts_with(run(&glove, bad[i]), "#ERR RATE "));
+        assert(glove.settings.scan_period_us == period_us);
+    }
+
+    assert(starts_with(run(&glove, "RATE 0x14"), "#OK RATE PERIOD_US 50000 "));
+    assert(starts_with(run(&glove, "RATE 300"), "#ERR RATE "));     // more than 115200 baud carries with timestamps
+    assert(glove.settings.scan_period_us == 50000u);
+
+    assert(starts_with(run(&glove, "TS 0"), "#OK TS "));
+    assert(starts_with(run(&glove, "RATE 300"), "#OK RATE PERIOD_US 3333 "));
+    assert(starts_with(run(&glove, "TS 1"), "#ERR TS "));           // the longer lines would not fit
+    assert(!glove.settings.send_timestamp);
+    assert(starts_with(run(&glove, "TS 2"), "#ERR TS "));
+}
+
+static void test_channels(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    const char *bad[] = { "CH", "CH 0", "CH 0x20", "CH 255" };
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert(starts_with(run(&glove, bad[i]), "#ERR CH "));
+        assert(glove.settings.channel_mask == 0x1Fu);
+    }
+
+    assert(starts_with(run(&glove, "CH 0x5"), "#OK CH "));
+    assert(strstr(reply, " CH 0x05 ") != NULL);
+
+    // Disabled channels read as 0, even in raw format
+    run(&glove, "FMT RAW");
+    glove_scan(&glove);
+    assert(glove.values[0] > 0 && glove.values[2] > 0);
+    assert(glove.values[1] == 0 && glove.values[3] == 0 && glove.values[4] == 0);
+}
+
+static void test_threshold(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    const char *bad[] = { "THR", "THR 0", "THR 1001", "THR low" };
+    for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert(starts_with(run(&glove, bad[i]), "#ERR THR "));
+        assert(glove.baseline.press_cn == BASELINE_PRESS_CN);
+    }
+
+    assert(starts_with(run(&glove, "THR 40"), "#OK THR "));
+    assert(glove.baseline.press_cn == 40);
+    assert(strstr(reply, " THR 40 ") != NULL);
+}
+
+// Switching format re-learns the baselines, the force format starts from 0
+static void test_format(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    glove_scan(&glove);
+    assert(glove.baseline.primed[0]);
+
+    assert(starts_with(run(&glove, "FMT"), "#ERR FMT "));
+    assert(starts_with(run(&glove, "FMT CN"), "#ERR FMT "));
+    assert(glove.settings.format == GLOVE_FORMAT_FORCE);
+    assert(glove.baseline.primed[0]);
+
+    assert(starts_with(run(&glove, "fmt raw"), "#OK FMT "));
+    assert(glove.settings.format == GLOVE_FORMAT_RAW);
+    assert(strstr(reply, " FMT RAW ") != NULL);
+    assert(!glove.baseline.primed[0]);
+    glove_scan(&glove);
+    assert(glove.values[0] > 100);      // counts, not cN above the baseline
+
+    assert(starts_with(run(&glove, "FMT FORCE"), "#OK FMT "));
+    assert(glove.settings.format == GLOVE_FORMAT_FORCE);
+    glove_scan(&glove);
+    for (uint8_t ch = 0; ch < GLOVE_NUM_CHANNELS; ch++)
+        assert(glove.values[ch] == 0);
+}
+
+static void test_other_lines(void)
+{
+    glove_t glove;
+    start(&glove);
+
+    assert(run(&glove, "")[0] == '\0');
+    assert(run(&glove, "  \t ")[0] == '\0');
+    assert(starts_with(run(&glove, "GET"), "#OK GET PERIOD_US 50000 AVG 1 CH 0x1F THR 15 "));
+    assert(starts_with(run(&glove, "HELLO"), "#ERR HELLO unknown command"));
+    assert(starts_with(run(&glove, "ACQ 50"), "#ERR ACQ "));
+    assert(starts_with(run(&glove, "ACQ 2000"), "#OK ACQ "));
+    assert(glove.settings.acquisition_ns == 2000u);
+}
+
+// Lines through the receive path: CR/LF handling, a line split across
+// polls, and an overlong line refused without eating the next one
+static void test_poll(void)
+{
+    glove_t glove;
+    glove_command_t command;
+    start(&glove);
+    glove_command_init(&command);
+
+    uint64_t before = glove_sim_bytes_written;
+    glove_sim_receive("\r\n\r\n");
+    glove_command_poll(&command, &glove);
+    assert(glove_sim_bytes_written == before);
+
+    glove_sim_receive("AV");
+    glove_command_poll(&command, &glove);
+    assert(glove_sim_bytes_written == before);
+    glove_sim_receive("G 4\r\n");
+    glove_command_poll(&command, &glove);
+    assert(starts_with(glove_sim_last_write(), "#OK AVG "));
+    assert(glove.settings.average_shift == 2);
+
+    char line[3 * GLOVE_COMMAND_SIZE];
+    memset(line, 'A', sizeof(line) - 1u);
+    line[sizeof(line) - 1u] = '\0';
+    glove_sim_receive("AVG 1 ");
+    glove_sim_receive(line);
+    glove_sim_receive("\n");
+    glove_command_poll(&command, &glove);
+    assert(strcmp(glove_sim_last_write(), "#ERR ? line too long\r\n") == 0);
+    assert(glove.settings.average_shift == 2);
+
+    // Exactly GLOVE_COMMAND_SIZE characters still fit
+    memset(line, ' ', GLOVE_COMMAND_SIZE);
+    memcpy(line + GLOVE_COMMAND_SIZE - 5u, "AVG 1", 5u);
+    line[GLOVE_COMMAND_SIZE] = '\0';
+    glove_sim_receive(line);
+    glove_sim_receive("\n");
+    glove_command_poll(&command, &glove);
+    assert(starts_with(glove_sim_last_write(), "#OK AVG "));
+    assert(glove.settings.average_shift == 0);
+
+    glove_sim_receive("GET\n");
+    glove_command_poll(&command, &glove);
+    assert(starts_with(glove_sim_last_write(), "#OK GET "));
+}
+
+int main(void)
+{
+    test_average();
+    test_numbers();
+    test_rate();
+    test_channels();
+    test_threshold();
+    test_format();
+    test_other_lines();
+    test_poll();
+    printf("test_command: ok\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*****************************************************************************
+* File Name:   test_linearize.c
+*
+* Description: Unit tests of glove_linearize.c against the FSR table built
+*              with the default parameters of tools/gen_fsr_lut.py: endpoints,
+*              monotonicity, clamping at 0 and at full scale.
+******************************************************************************/
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "fsr_lut.h"
+#include "glove_config.h"
+#include "glove_linearize.h"
+
+#define FULL_SCALE_COUNTS         ((1u << GLOVE_ADC_BITS) - 1u)
+
+static void test_endpoints(void)
+{
+    // No current through an unloaded FSR, rail with the FSR shorted
+    assert(glove_linearize(0) == 0);
+    assert(glove_linearize(FULL_SCALE_COUNTS) == FSR_LUT_MAX_CN);
+
+    // At 1 N the FSR equals the divider resistor: half scale
+    int32_t one_newton = glove_linearize(1u << (GLOVE_ADC_BITS - 1u));
+    assert(one_newton >= 99 && one_newton <= 101);
+}
+
+static void test_monotonic(void)
+{
+    int32_t previous = glove_linearize(0);
+    for (uint32_t counts = 1; counts <= FULL_SCALE_COUNTS; counts++)
+    {
+        int32_t force_cn = glove_linearize((uint16_t)counts);
+        assert(force_cn >= previous);
+        previous = force_cn;
+    }
+}
+
+static void test_clamped(void)
+{
+    for (uint32_t counts = 0; counts <= FULL_SCALE_COUNTS; counts++)
+    {
+        int32_t force_cn = glove_linearize((uint16_t)counts);
+        assert(force_cn >= 0 && force_cn <= FSR_LUT_MAX_CN);
+    }
+
+    // The table saturates before the rail instead of running off to infinity
+    assert(glove_linearize(FULL_SCALE_COUNTS - 1u) == FSR_LUT_MAX_CN);
+
+    // Counts wider than the ADC saturate instead of wrapping to the bottom
+    for (uint32_t counts = FULL_SCALE_COUNTS + 1u; counts <= UINT16_MAX; counts += 97u)
+        assert(glove_linearize((uint16_t)counts) == FSR_LUT_MAX_CN);
+    assert(glove_linearize(FULL_SCALE_COUNTS + 1u) == FSR_LUT_MAX_CN);
+    assert(glove_linearize(UINT16_MAX) == FSR_LUT_MAX_CN);
+}
+
+int main(void)
+{
+    test_endpoints();
+    test_monotonic();
+    test_clamped();
+    printf("test_linearize: ok\n");
+    return 0;
+}
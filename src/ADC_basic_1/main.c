@@ -551,64 +551,15 @@
 #include "cybsp.h"
 #include "cy_retarget_io.h"
 
-#define MICRO_TO_MILLI_CONV_RATIO (1000u)
-#define ACQUISITION_TIME_NS       (1000u)
-#define ADC_SCAN_DELAY_MS         (50u)
+#include "glove.h"
+#include "glove_command.h"
+#include "glove_hal.h"
 
-// Define ADC input pins
-cyhal_gpio_t input_pins[] = {P10_0, P10_1, P10_2, P10_3, P10_4};
-#define NUM_INPUTS (sizeof(input_pins) / sizeof(input_pins[0]))
-
-cyhal_adc_t adc_obj;
-cyhal_adc_channel_t adc_chan;
-
-const cyhal_adc_config_t adc_config = {
-    .continuous_scanning = false,
-    .average_count = 1,
-    .vref = CYHAL_ADC_REF_VDDA,
-    .vneg = CYHAL_ADC_VNEG_VSSA,
-    .resolution = 12u,
-    .ext_vref = NC,
-    .bypass_pin = NC
-};
-
-void read_all_channels()
-{
-    for (int i = 0; i < NUM_INPUTS; i++)
-    {
-        // Re-initialize channel for new input pin
-        cyhal_adc_channel_t chan;
-        cy_rslt_t result = cyhal_adc_channel_init_diff(&chan, &adc_obj, input_pins[i], CYHAL_ADC_VNEG, &(cyhal_adc_channel_config_t){
-            .enable_averaging = false,
-            .min_acquisition_ns = ACQUISITION_TIME_NS,
-            .enabled = true
-        });
-
-        if (result != CY_RSLT_SUCCESS)
-        {
-            printf("ADC Channel %d init failed: %ld\n", i, (long unsigned int)result);
-            CY_ASSERT(0);
-        }
-
-        // Read and convert to mV
-        int32_t adc_val = cyhal_adc_read_uv(&chan) / MICRO_TO_MILLI_CONV_RATIO;
-
-//		printf("CH%d: %4ld mV\t", i, (long int)adc_val);
-
-        if(i < NUM_INPUTS - 1)
-    		printf("%6ld,", (long int)adc_val);
-        else
-    		printf("%6ld", (long int)adc_val);
-
-
-
-
-        // Free channel before next
-        cyhal_adc_channel_free(&chan);
-    }
-
-    printf("\r\n");
-}
+// Channel reading, baseline tracking, output formatting and the RX command
+// channel live in glove/ behind glove_hal.h so they also build and run on the
+// host (see host/).
+static glove_t glove;
+static glove_command_t command;
 
 int main(void)
 {
@@ -630,7 +581,8 @@ int main(void)
 
     __enable_irq();
 
-    result = cy_retarget_io_init(CYBSP_DEBUG_UART_TX, CYBSP_DEBUG_UART_RX, CY_RETARGET_IO_BAUDRATE);
+    // RATE checks the scan rate against GLOVE_UART_BAUD, so the UART runs at it
+    result = cy_retarget_io_init(CYBSP_DEBUG_UART_TX, CYBSP_DEBUG_UART_RX, GLOVE_UART_BAUD);
     if (result != CY_RSLT_SUCCESS)
     {
         CY_ASSERT(0);
@@ -639,24 +591,15 @@ int main(void)
     printf("\x1b[2J\x1b[;H"); // Clear screen
     printf("PSoC6 ADC Read Example - Single ADC, Multiple Inputs\r\n");
 
-    // Initialize ADC core
-    result = cyhal_adc_init(&adc_obj, input_pins[0], NULL);
-    if (result != CY_RSLT_SUCCESS)
-    {
-        printf("ADC init failed: %ld\n", (long unsigned int)result);
-        CY_ASSERT(0);
-    }
-
-    result = cyhal_adc_configure(&adc_obj, &adc_config);
-    if (result != CY_RSLT_SUCCESS)
-    {
-        printf("ADC config failed: %ld\n", (long unsigned int)result);
-        CY_ASSERT(0);
-    }
+    glove_hal_init();
+    glove_init(&glove);
+    glove_command_init(&command);
 
     while (1)
     {
-        read_all_channels();
-        cyhal_system_delay_ms(ADC_SCAN_DELAY_MS);
+        uint32_t start_us = glove_hal_time_us();
+        glove_command_poll(&command, &glove);
+        glove_scan(&glove);
+        glove_wait_period(&glove, start_us);
     }
 }
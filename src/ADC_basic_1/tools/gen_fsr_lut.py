@@ -0,0 +1,77 @@
+# gen_fsr_lut.py
+"""
+編譯前產生 FSR 線性化查表 glove/fsr_lut.h（ModusToolbox 的 PREBUILD 與 host/Makefile 都會呼叫）。
+
+電路：FSR 接在 VDDA 與 ADC 輸入之間，分壓電阻接地，ADC 以 VDDA 為參考，所以
+    counts / 2^bits = R_div / (R_div + R_fsr)
+感測器曲線（冪次律）：
+    R_fsr = R_1N / F^exponent      （F 以牛頓為單位）
+查表把每個 ADC counts 直接換成力（centinewton），韌體執行時只剩一次查表。
+"""
+import argparse
+
+DEFAULT_DIVIDER_OHMS = 10000.0
+DEFAULT_FSR_OHMS_1N = 10000.0   # 1 N 時 FSR 的電阻
+DEFAULT_EXPONENT = 0.9
+DEFAULT_MAX_FORCE_CN = 2000     # 超過 20 N 視為飽和
+DEFAULT_BITS = 12
+
+
+def counts_to_force_cn(counts, bits, divider_ohms, fsr_ohms_1n, exponent, max_force_cn):
+    full_scale = 1 << bits
+    if counts <= 0:
+        return 0
+    if counts >= full_scale:
+        return max_force_cn
+    fsr_ohms = divider_ohms * (full_scale - counts) / counts
+    force_n = (fsr_ohms_1n / fsr_ohms) ** (1.0 / exponent)
+    return min(max_force_cn, int(round(force_n * 100)))
+
+
+def generate(bits, divider_ohms, fsr_ohms_1n, exponent, max_force_cn):
+    table = [counts_to_force_cn(c, bits, divider_ohms, fsr_ohms_1n, exponent, max_force_cn)
+             for c in range(1 << bits)]
+    lines = [
+        "// Generated by tools/gen_fsr_lut.py at build time -- do not edit.",
+        f"// divider {divider_ohms:.0f} ohm, FSR {fsr_ohms_1n:.0f} ohm at 1 N, "
+        f"exponent {exponent:g}, saturates at {max_force_cn} cN",
+        "",
+        "#ifndef FSR_LUT_H",
+        "#define FSR_LUT_H",
+        "",
+        "#include <stdint.h>",
+        "",
+        f"#define FSR_LUT_BITS              ({bits}u)",
+        f"#define FSR_LUT_MAX_CN            ({max_force_cn})",
+        "",
+        f"static const uint16_t fsr_lut[{len(table)}] = {{",
+    ]
+    for i in range(0, len(table), 16):
+        lines.append("    " + ", ".join(f"{v:4d}" for v in table[i:i + 16]) + ",")
+    lines += ["};", "", "#endif /* FSR_LUT_H */", ""]
+    return "\n".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="產生 ADC counts → 力（cN）的 FSR 線性化查表")
+    parser.add_argument("output", help="輸出的 header，例如 glove/fsr_lut.h")
+    parser.add_argument("--bits", type=int, default=DEFAULT_BITS, help="ADC 解析度")
+    parser.add_argument("--divider-ohms", type=float, default=DEFAULT_DIVIDER_OHMS, help="分壓電阻（Ω）")
+    parser.add_argument("--fsr-ohms-1n", type=float, default=DEFAULT_FSR_OHMS_1N, help="1 N 時 FSR 的電阻（Ω）")
+    parser.add_argument("--exponent", type=float, default=DEFAULT_EXPONENT, help="FSR 電阻對力的冪次")
+    parser.add_argument("--max-force-cn", type=int, default=DEFAULT_MAX_FORCE_CN, help="飽和的力（cN）")
+    args = parser.parse_args()
+
+    text = generate(args.bits, args.divider_ohms, args.fsr_ohms_1n, args.exponent, args.max_force_cn)
+    try:
+        with open(args.output) as f:
+            if f.read() == text:
+                return  # 內容沒變就不覆寫，避免每次都重新編譯
+    except FileNotFoundError:
+        pass
+    with open(args.output, "w") as f:
+        f.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,300 @@
+# audio_backend.py
+import os
+import threading
+import time
+
+import numpy as np
+
+DEFAULT_SAMPLE_RATE = 44100
+DEFAULT_PERIOD_SIZE = 256   # 每個 period 的 frame 數
+DEFAULT_PERIODS = 2         # buffer = period_size * periods
+MIN_PERIOD_SIZE = 64
+
+
+def request_realtime_priority(priority=70):
+    """
+    嘗試把「目前執行緒」設為 SCHED_FIFO 即時排程。
+    Linux 上 pid 0 代表呼叫者本身的 thread；沒有權限（未設定 rtprio limit）時回傳 False。
+    """
+    if not hasattr(os, "sched_setscheduler"):
+        return False
+    try:
+        os.sched_setscheduler(0, os.SCHED_FIFO, os.sched_param(priority))
+        return True
+    except (PermissionError, OSError):
+        return False
+
+
+class BackendStats:
+    """音訊 callback 的統計：xrun 次數、callback 耗時、實測輸出延遲"""
+
+    def __init__(self):
+        self.xruns = 0
+        self.callbacks = 0
+        self.callback_time_total = 0.0
+        self.callback_time_max = 0.0
+        self.last_callback_time = 0.0
+        self.output_latency = None  # 秒，由 backend 實際量測
+        self.output_latency_estimated = False  # True = 驅動沒有提供，以主機時鐘推算
+
+    def record_callback(self, duration):
+        self.callbacks += 1
+        self.last_callback_time = duration
+        self.callback_time_total += duration
+        if duration > self.callback_time_max:
+            self.callback_time_max = duration
+
+    def snapshot(self):
+        avg = self.callback_time_total / self.callbacks if self.callbacks else 0.0
+        return {
+            "xruns": self.xruns,
+            "callbacks": self.callbacks,
+            "callback_avg_ms": avg * 1000,
+            "callback_max_ms": self.callback_time_max * 1000,
+            "output_latency_ms": None if self.output_latency is None else self.output_latency * 1000,
+            "output_latency_estimated": self.output_latency_estimated,
+        }
+
+
+class AudioBackend:
+    """
+    所有音訊輸出後端的共同介面。
+    start(render) 之後，後端會以 render(outdata, frames) 向上層要資料，
+    outdata 為 float32 的 (frames, channels) 陣列，由 render 直接填入。
+    """
+
+    name = "base"
+
+    def __init__(self, sample_rate=DEFAULT_SAMPLE_RATE, channels=1,
+                 period_size=DEFAULT_PERIOD_SIZE, periods=DEFAULT_PERIODS, realtime=True):
+        if period_size < MIN_PERIOD_SIZE:
+            raise ValueError(f"period_size 至少要 {MIN_PERIOD_SIZE} frames")
+        self.sample_rate = sample_rate
+        self.channels = channels
+        self.period_size = period_size
+        self.periods = periods
+        self.realtime = realtime
+        self.stats = BackendStats()
+        self._render = None
+
+    @property
+    def nominal_latency(self):
+        return self.period_size * self.periods / self.sample_rate
+
+    def _run_render(self, outdata, frames):
+        start = time.perf_counter()
+        self._render(outdata, frames)
+        self.stats.record_callback(time.perf_counter() - start)
+
+    def start(self, render):
+        raise NotImplementedError
+
+    def stop(self):
+        raise NotImplementedError
+
+
+class SoundDeviceBackend(AudioBackend):
+    """
+    透過 PortAudio（sounddevice）輸出，但明確指定 blocksize 與 latency。
+    hostapi 可指定 "ALSA"、"JACK Audio Connection Kit" 等；PipeWire 通常以 JACK 或 ALSA 形式出現。
+    """
+
+    name = "portaudio"
+
+    def __init__(self, hostapi=None, device=None, **kwargs):
+        super().__init__(**kwargs)
+        self.hostapi = hostapi
+        self.device = device
+        self._stream = None
+        self._rt_requested = False
+
+    def _find_device(self, sd):
+        if self.device is not None or self.hostapi is None:
+            return self.device
+        for api in sd.query_hostapis():
+            if self.hostapi.lower() in api["name"].lower():
+                return api["default_output_device"]
+        print(f"⚠️ 找不到 host API {self.hostapi}，改用預設裝置")
+        return None
+
+    def start(self, render):
+        import sounddevice as sd
+
+        self._render = render
+
+        def callback(outdata, frames, time_info, status):
+            if self.realtime and not self._rt_requested:
+                # 只在 PortAudio 的音訊 thread 裡設定一次
+                self._rt_requested = True
+                request_realtime_priority()
+            if status.output_underflow:
+                self.stats.xruns += 1
+            self.stats.output_latency = time_info.outputBufferDacTime - time_info.currentTime
+            self._run_render(outdata, frames)
+
+        self._stream = sd.OutputStream(
+            samplerate=self.sample_rate,
+            blocksize=self.period_size,
+            latency=self.nominal_latency,
+            channels=self.channels,
+            dtype="float32",
+            device=self._find_device(sd),
+            callback=callback,
+        )
+        self._stream.start()
+
+    def stop(self):
+        if self._stream is not None:
+            self._stream.stop()
+            self._stream.close()
+            self._stream = None
+
+
+class AlsaBackend(AudioBackend):
+    """
+    直接以 pyalsaaudio 開啟 ALSA PCM，自己掌控 period 大小與數量。
+    寫入由獨立 thread 負責，PCM_NORMAL 模式下 write 會阻塞到 buffer 有空間為止。
+    """
+
+    name = "alsa"
+
+    def __init__(self, device="default", **kwargs):
+        super().__init__(**kwargs)
+        self.device = device
+        self._pcm = None
+        self._thread = None
+        self._running = False
+
+    def start(self, render):
+        import alsaaudio
+
+        self._render = render
+        self._pcm = alsaaudio.PCM(
+            type=alsaaudio.PCM_PLAYBACK,
+            mode=alsaaudio.PCM_NORMAL,
+            device=self.device,
+            rate=self.sample_rate,
+            channels=self.channels,
+            format=alsaaudio.PCM_FORMAT_FLOAT_LE,
+            periodsize=self.period_size,
+            periods=self.periods,
+        )
+        self._running = True
+        self._thread = threading.Thread(target=self._write_loop, args=(alsaaudio,), daemon=True,
+                                        name="audio_alsa")
+        self._thread.start()
+
+    def _write_loop(self, alsaaudio):
+        if self.realtime:
+            request_realtime_priority()
+        buf = np.zeros((self.period_size, self.channels), dtype=np.float32)
+        xrun_state = getattr(alsaaudio, "PCM_STATE_XRUN", None)
+        # 較新的 pyalsaaudio 可以問 ALSA buffer 還有多少空位；舊版只能用主機時鐘推算
+        measured = hasattr(self._pcm, "avail")
+        buffer_frames = self.period_size * self.periods
+        if measured and hasattr(self._pcm, "info"):
+            buffer_frames = self._pcm.info().get("buffer_size", buffer_frames)
+        self.stats.output_latency_estimated = not measured
+        written = 0
+        started = None
+        while self._running:
+            buf.fill(0.0)
+            self._run_render(buf, self.period_size)
+            # 同一次 underrun 可能同時出現在 state、write 的回傳值與時鐘推算上，只計一次
+            xrun = xrun_state is not None and self._pcm.state() == xrun_state
+            if self._pcm.write(buf.tobytes()) < 0:
+                xrun = True
+            if measured:
+                # 還在 buffer 中尚未播出的 frame 數 = buffer 大小 - 空位
+                queued = max(0, buffer_frames - self._pcm.avail())
+            else:
+                now = time.perf_counter()
+                if started is None:
+                    started = now
+                written += self.period_size
+                queued = written - (now - started) * self.sample_rate
+                if queued < 0:
+                    # 寫入落後於播放時鐘，代表剛剛發生過 underrun，重新對齊
+                    xrun = True
+                    written = 0
+                    started = now
+                    queued = 0
+            if xrun:
+                self.stats.xruns += 1
+            self.stats.output_latency = queued / self.sample_rate
+
+    def stop(self):
+        self._running = False
+        if self._thread is not None:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+        if self._pcm is not None:
+            self._pcm.close()
+            self._pcm = None
+
+
+class NullBackend(AudioBackend):
+    """
+    不輸出聲音的後端，給 headless 測試 / benchmark 用。
+    paced=True 時以實際時間節奏呼叫 render（錯過 deadline 計為 xrun），
+    paced=False 時不啟動 thread，由呼叫端用 pull() 盡快拉資料。
+    """
+
+    name = "null"
+
+    def __init__(self, paced=True, **kwargs):
+        super().__init__(**kwargs)
+        self.paced = paced
+        self._thread = None
+        self._running = False
+
+    def start(self, render):
+        self._render = render
+        self.stats.output_latency = 0.0
+        if not self.paced:
+            return
+        self._running = True
+        self._thread = threading.Thread(target=self._paced_loop, daemon=True, name="audio_null")
+        self._thread.start()
+
+    def pull(self, frames=None):
+        frames = frames or self.period_size
+        buf = np.zeros((frames, self.channels), dtype=np.float32)
+        self._run_render(buf, frames)
+        return buf
+
+    def _paced_loop(self):
+        if self.realtime:
+            request_realtime_priority()
+        period = self.period_size / self.sample_rate
+        deadline = time.perf_counter() + period
+        while self._running:
+            self.pull()
+            now = time.perf_counter()
+            if now > deadline:
+                self.stats.xruns += 1
+                deadline = now
+            else:
+                time.sleep(deadline - now)
+            deadline += period
+
+    def stop(self):
+        self._running = False
+        if self._thread is not None:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+
+
+BACKENDS = {
+    "portaudio": SoundDeviceBackend,
+    "alsa": AlsaBackend,
+    "jack": lambda **kw: SoundDeviceBackend(hostapi="JACK", **kw),
+    "null": NullBackend,
+}
+
+
+def open_backend(name="portaudio", **kwargs):
+    """依名稱建立音訊後端：portaudio / alsa / jack / null"""
+    if name not in BACKENDS:
+        raise ValueError(f"未知的音訊後端 {name}，可用：{', '.join(BACKENDS)}")
+    return BACKENDS[name](**kwargs)
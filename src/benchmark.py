@@ -0,0 +1,258 @@
+# benchmark.py
+import argparse
+import csv
+import json
+import os
+import time
+
+import cv2
+import numpy as np
+
+from audio_backend import NullBackend
+from hand_detector import close_detector, detect_hands, load_detector
+from new_screen_mapper import generate_keyboard_mapping, NoteLUT
+from new_sound_manager import SoundManager, SAMPLE_RATE
+from note_controller import NoteController, FINGER_INDICES
+from pressure_reader import PRESS_THRESHOLD
+
+AUDIO_BLOCK = 256
+
+# 錄製檔案結構：<錄製資料夾>/video.avi、pressure.csv（time,p0..p4；雙手時 p5..p9 為左手）、meta.json
+# pressure.csv 每收到一筆手套資料就記一行（meta 的 pressure_timing = "sample"，frame_times 為每個 frame 的時間）；
+# 較舊的錄製每個 frame 才記一次壓力（pressure_timing 缺少或為 "frame"）
+VIDEO_NAME = "video.avi"
+PRESSURE_NAME = "pressure.csv"
+META_NAME = "meta.json"
+
+
+class PressureLog:
+    """錄好的壓力紀錄，依虛擬時間查詢每隻手每根手指的壓力"""
+
+    def __init__(self, path):
+        rows = []
+        with open(path, newline="") as f:
+            reader = csv.DictReader(f)
+            columns = [name for name in reader.fieldnames if name.startswith("p")]
+            for row in reader:
+                rows.append([float(row["time"])] + [int(row[name]) for name in columns])
+        data = np.array(rows, dtype=np.float64).reshape(-1, 1 + len(columns))
+        self.times = data[:, 0]
+        self.values = data[:, 1:]
+        self.now = 0.0
+
+    def pressure(self, hand, index):
+        if hand == "left":
+            index += 5
+        i = np.searchsorted(self.times, self.now, side="right") - 1
+        return int(self.values[i, index]) if i >= 0 and index < self.values.shape[1] else 0
+
+    def onsets(self):
+        """所有手指壓力向上穿過門檻的時間（排序後）"""
+        pressed = self.values > PRESS_THRESHOLD
+        rising = pressed[1:] & ~pressed[:-1]
+        return np.sort(self.times[1:][rising.any(axis=1)])
+
+
+def _stage_stats(samples):
+    ms = np.array(samples) * 1000 if samples else np.zeros(1)
+    return float(ms.mean()), float(np.percentile(ms, 99))
+
+
+def replay(recording, scale=1.0):
+    """以最快速度重播一份錄製，回傳效能統計"""
+    with open(os.path.join(recording, META_NAME)) as f:
+        meta = json.load(f)
+    log = PressureLog(os.path.join(recording, PRESSURE_NAME))
+    onsets = log.onsets()
+    frame_times = meta.get("frame_times")
+
+    cap = cv2.VideoCapture(os.path.join(recording, VIDEO_NAME))
+    fps = meta.get("fps") or cap.get(cv2.CAP_PROP_FPS) or 30.0
+    width = int(meta["width"] * scale)
+    height = int(meta["height"] * scale)
+    white_keys, black_keys, _, _ = generate_keyboard_mapping(width, meta["pixel_per_cm"] * scale)
+    load_detector(max_hands=meta.get("hands", 1))
+
+    backend = NullBackend(paced=False, sample_rate=SAMPLE_RATE, channels=2, period_size=AUDIO_BLOCK)
+    sound_manager = SoundManager(backend=backend, clock=lambda: log.now, monitor=False)
+    sound_manager.preload_notes([key["note"] for key in white_keys + black_keys])
+    controller = NoteController(sound_manager, white_keys, black_keys, height, pressure_fn=log.pressure,
+                                note_lut=NoteLUT(white_keys, black_keys, width, height))
+
+    stages = {"decode": [], "inference": [], "decision": [], "audio": []}
+    decision_latency = []
+    frames = 0
+    audio_frames = 0
+    start = time.perf_counter()
+    while True:
+        t0 = time.perf_counter()
+        ret, frame = cap.read()
+        if not ret:
+            break
+        if scale != 1.0:
+            frame = cv2.resize(frame, (width, height), interpolation=cv2.INTER_AREA)
+        frame = cv2.flip(frame, 1)
+        log.now = frame_times[frames] if frame_times and frames < len(frame_times) else frames / fps
+        t1 = time.perf_counter()
+
+        positions = detect_hands(frame, finger_indices=FINGER_INDICES)
+        t2 = time.perf_counter()
+
+        started = controller.update(positions, log.now)
+        t3 = time.perf_counter()
+
+        # 音訊 render 跟上虛擬時間
+        sound_manager._check_and_stop_expired_notes()
+        while audio_frames < log.now * SAMPLE_RATE:
+            backend.pull(AUDIO_BLOCK)
+            audio_frames += AUDIO_BLOCK
+        t4 = time.perf_counter()
+
+        # 判斷延遲 = 壓力越過門檻 → 這個 frame 的時間點 + 處理到做出判斷所花的時間
+        # （壓力只按 frame 記錄的舊錄製，越過門檻的時間就是 frame 時間，只剩每 frame 的處理時間）
+        if started:
+            i = np.searchsorted(onsets, log.now, side="right") - 1
+            if i >= 0:
+                decision_latency.append(log.now - onsets[i] + (t3 - t0))
+
+        stages["decode"].append(t1 - t0)
+        stages["inference"].append(t2 - t1)
+        stages["decision"].append(t3 - t2)
+        stages["audio"].append(t4 - t3)
+        frames += 1
+    elapsed = time.perf_counter() - start
+    cap.release()
+    sound_manager.close()
+    close_detector()  # 下一份錄製的手數可能不同
+
+    return {
+        "recording": os.path.basename(os.path.normpath(recording)),
+        "resolution": f"{width}x{height}",
+        "hands": meta.get("hands", 1),
+        "frames": frames,
+        "fps": frames / elapsed if elapsed else 0.0,
+        "stages": {name: _stage_stats(samples) for name, samples in stages.items()},
+        "decision_latency": _stage_stats(decision_latency) if decision_latency else None,
+        "pressure_timing": meta.get("pressure_timing", "frame"),
+    }
+
+
+def record(recording, seconds, pixel_per_cm, hands, left_port=None):
+    """從攝影機與手套錄一段 session，存成可重播的格式"""
+    from camera import CameraSession
+    from pressure_reader import gloves, open_serial
+
+    os.makedirs(recording, exist_ok=True)
+    open_serial()
+    glove_hands = ["right"]
+    if hands > 1:
+        open_serial(left_port, hand="left")
+        glove_hands.append("left")
+    camera = CameraSession(0)
+    ret, frame = camera.read()
+    if not ret:
+        print("❌ 無法讀取攝影機影像")
+        return
+    width, height = camera.resolution
+    fps = camera.cap.get(cv2.CAP_PROP_FPS) or 30.0
+    writer = cv2.VideoWriter(os.path.join(recording, VIDEO_NAME),
+                             cv2.VideoWriter_fourcc(*"MJPG"), fps, (width, height))
+
+    print(f"🔴 錄製 {seconds} 秒到 {recording} ...")
+    # 壓力每收到一筆就記下（在讀取 thread 上），frame 另外記時間，重播時以同一個時間軸對齊
+    start = time.perf_counter()
+    samples = []
+    glove_streams = [gloves[hand] for hand in glove_hands if hand in gloves]
+
+    def on_sample(stream):
+        values = [v for hand in glove_hands for v in (gloves[hand].value if hand in gloves else [0] * 5)]
+        samples.append([time.perf_counter() - start] + values)
+
+    for glove in glove_streams:
+        glove.listeners.append(on_sample)
+    frame_times = []
+    while ret and len(frame_times) < seconds * fps:
+        frame_times.append(time.perf_counter() - start)
+        writer.write(frame)
+        ret, frame = camera.read()
+    for glove in glove_streams:
+        glove.listeners.remove(on_sample)
+
+    with open(os.path.join(recording, PRESSURE_NAME), "w", newline="") as f:
+        out = csv.writer(f)
+        out.writerow(["time"] + [f"p{i}" for i in range(5 * len(glove_hands))])
+        for row in list(samples):
+            out.writerow([f"{row[0]:.4f}"] + row[1:])
+    frame_index = len(frame_times)
+
+    writer.release()
+    camera.release()
+    with open(os.path.join(recording, META_NAME), "w") as f:
+        json.dump({"width": width, "height": height, "fps": fps,
+                   "pixel_per_cm": pixel_per_cm, "hands": hands, "pressure_timing": "sample",
+                   "frame_times": [round(t, 4) for t in frame_times]}, f, indent=2)
+    print(f"✅ 錄製完成：{frame_index} 個 frame")
+
+
+def print_report(results):
+    print(f"\n{'錄製':<16}{'解析度':>11}{'手':>3}{'fps':>8}"
+          f"{'解碼':>9}{'推論':>9}{'判斷':>9}{'音訊':>9}{'判斷延遲 p50/p99 (ms)':>24}")
+    for r in results:
+        stages = "".join(f"{r['stages'][s][0]:>9.2f}" for s in ("decode", "inference", "decision", "audio"))
+        latency = r["decision_latency"]
+        latency_text = f"{latency[0]:.1f} / {latency[1]:.1f}" if latency else "-"
+        if latency and r["pressure_timing"] == "frame":
+            latency_text += "*"
+        print(f"{r['recording']:<16}{r['resolution']:>11}{r['hands']:>3}{r['fps']:>8.1f}{stages}{latency_text:>24}")
+    print("（各階段為每 frame 平均 ms）")
+    if any(r["decision_latency"] and r["pressure_timing"] == "frame" for r in results):
+        print("* 舊錄製的壓力只在每個 frame 記一次，按下的時間無法早於 frame，判斷延遲只反映每 frame 的處理時間；"
+              "請用 --record 重新錄製")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="以錄好的 session 重播完整流程並量測效能")
+    parser.add_argument("recordings", nargs="*", default=["recordings"],
+                        help="錄製資料夾，或包含多個錄製資料夾的上層資料夾")
+    parser.add_argument("--scales", default="1.0",
+                        help="以逗號分隔的縮放比例，用同一份錄製測不同解析度（如 0.5,1.0）")
+    parser.add_argument("--json", default=None, help="另外把結果寫成 JSON 檔，方便跨版本比較")
+    parser.add_argument("--record", default=None, metavar="DIR", help="改為錄製新的 session 到 DIR")
+    parser.add_argument("--seconds", type=float, default=20.0)
+    parser.add_argument("--pixel-per-cm", type=float, default=None)
+    parser.add_argument("--hands", type=int, default=1, choices=[1, 2])
+    parser.add_argument("--left-port", default=None, help="雙手錄製時左手手套的序列埠")
+    args = parser.parse_args()
+
+    if args.record:
+        if args.pixel_per_cm is None:
+            print("⚠️ 錄製時請用 --pixel-per-cm 指定校正值")
+            return
+        if args.hands > 1 and args.left_port is None:
+            print("⚠️ 雙手錄製請用 --left-port 指定左手手套的序列埠")
+            return
+        record(args.record, args.seconds, args.pixel_per_cm, args.hands, args.left_port)
+        return
+
+    recordings = []
+    for path in args.recordings:
+        if os.path.exists(os.path.join(path, META_NAME)):
+            recordings.append(path)
+        elif os.path.isdir(path):
+            recordings += sorted(os.path.join(path, d) for d in os.listdir(path)
+                                 if os.path.exists(os.path.join(path, d, META_NAME)))
+    if not recordings:
+        print("⚠️ 找不到任何錄製，請先用 --record 錄一段")
+        return
+
+    scales = [float(s) for s in args.scales.split(",")]
+    results = [replay(rec, scale) for rec in recordings for scale in scales]
+    close_detector()
+    print_report(results)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,32 +1,163 @@
 # src/calibration.py
 
+import collections
+import json
+import os
+
 import cv2
-import mediapipe as mp
+import numpy as np
+
+import hand_detector
+
+PROFILE_PATH = os.path.expanduser("~/.piano_glove/profile.json")
+DEFAULT_HAND_SPAN_CM = 20.0   # 成人拇指到小指張開的平均距離
+
+# 手掌上不隨手指張合改變長度的骨段（landmark 對），以及它們佔手掌張開距離的平均比例；
+# 互動校正過的使用者會在 profile 裡存自己實測的長度
+PALM_SEGMENTS = {
+    (0, 5): 0.45,   # 手腕 → 食指根部
+    (0, 9): 0.48,   # 手腕 → 中指根部
+    (0, 17): 0.40,  # 手腕 → 小指根部
+    (5, 17): 0.36,  # 食指根部 → 小指根部
+}
+
+
+def load_profile(path=PROFILE_PATH):
+    """讀取使用者 profile（手掌張開距離等），不存在時回傳空 dict"""
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return {}
+
+
+def save_profile(profile, path=PROFILE_PATH):
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, "w") as f:
+        json.dump(profile, f, indent=2)
+
 
-def calibrate_pixel_to_cm():
+def to_plane(points, homography):
+    """把影像上的 pixel 座標（N, 2）投影到鍵盤平面；homography 為 None 時原樣回傳"""
+    if homography is None:
+        return points
+    return cv2.perspectiveTransform(np.asarray(points, dtype=np.float64)[None], homography)[0]
+
+
+def _segment_lengths(landmarks):
+    """landmarks: (21, 2) pixel 座標 → 每個手掌骨段的 pixel 長度"""
+    pairs = np.array(list(PALM_SEGMENTS))
+    return np.linalg.norm(landmarks[pairs[:, 0]] - landmarks[pairs[:, 1]], axis=1)
+
+
+class HandSpanEstimator:
     """
-    啟動攝影機，偵測拇指與小指的 pixel 距離，讓使用者輸入真實距離，計算 pixel/cm。
+    演奏中持續估計 pixel/cm，不需要停下來校正。
+    每個 frame 以多個手掌骨段各自換算出一個 pixel/cm 取中位數，
+    再對最近 window 個 frame 的結果取中位數，單張 frame 的雜訊或姿勢誤差不會影響結果。
     """
 
-    # Mediapipe 手部模型初始化
-    mp_hands = mp.solutions.hands
-    hands = mp_hands.Hands(
-        static_image_mode=False,
-        max_num_hands=1,
-        min_detection_confidence=0.7
-    )
-    mp_draw = mp.solutions.drawing_utils
+    def __init__(self, profile=None, window=60, min_samples=15, homography=None):
+        profile = profile or {}
+        self.homography = homography  # 有鏡頭角度校正時，在鍵盤平面上量長度
+        span_cm = profile.get("hand_span_cm", DEFAULT_HAND_SPAN_CM)
+        measured = profile.get("segments_cm", {})
+        self.segments_cm = np.array([
+            measured.get(f"{a}-{b}", ratio * span_cm) for (a, b), ratio in PALM_SEGMENTS.items()
+        ])
+        self.min_samples = min_samples
+        self._samples = collections.deque(maxlen=window)
+
+    def observe(self, landmarks):
+        """餵入一隻手的 landmark，回傳這個 frame 的 pixel/cm 估計"""
+        lengths = _segment_lengths(to_plane(landmarks, self.homography))
+        estimate = float(np.median(lengths / self.segments_cm))
+        self._samples.append(estimate)
+        return estimate
+
+    @property
+    def ready(self):
+        return len(self._samples) >= self.min_samples
+
+    @property
+    def pixel_per_cm(self):
+        """目前的穩定估計；樣本不足時回傳 None"""
+        if not self.ready:
+            return None
+        return float(np.median(self._samples))
+
+def calibrate_homography(camera, width, height):
+    """
+    鏡頭角度校正（--perspective）：在畫面上依序點選鍵盤區域的左上、右上、右下、左下四個角，
+    算出影像 → 鍵盤平面（width x height 的俯視矩形）的 homography，並存進 profile。
+    """
+    window = "Perspective"
+    corners = []
+
+    def on_mouse(event, x, y, flags, param):
+        if event == cv2.EVENT_LBUTTONDOWN and len(corners) < 4:
+            corners.append((x, y))
+
+    print("📐 請依序點選鍵盤區域的 左上 → 右上 → 右下 → 左下 四個角")
+    print("⌨️ 按 'r' 重新點選、Enter 確認、'q' 取消")
+    cv2.namedWindow(window)
+    cv2.setMouseCallback(window, on_mouse)
 
-    # 開啟攝影機
-    cap = cv2.VideoCapture(0)
+    confirmed = False
+    while True:
+        ret, frame = camera.read()
+        if not ret:
+            print("❌ 無法讀取攝影機影像")
+            break
+        frame = cv2.flip(frame, 1)
+        for point in corners:
+            cv2.circle(frame, point, 6, (0, 0, 255), cv2.FILLED)
+        if len(corners) > 1:
+            cv2.polylines(frame, [np.int32(corners)], len(corners) == 4, (0, 255, 0), 2)
+        cv2.imshow(window, frame)
+
+        key = cv2.waitKey(1) & 0xFF
+        if key == ord('r'):
+            corners.clear()
+        elif key in (13, 10) and len(corners) == 4:
+            confirmed = True
+            break
+        elif key == ord('q'):
+            break
+
+    cv2.destroyWindow(window)
+    if not confirmed:
+        print("⚠️ 未完成鏡頭角度校正")
+        return None
+
+    target = np.float32([[0, 0], [width, 0], [width, height], [0, height]])
+    homography = cv2.getPerspectiveTransform(np.float32(corners), target)
+
+    profile = load_profile()
+    profile["homography"] = homography.tolist()
+    save_profile(profile)
+    print("✅ 鏡頭角度校正完成")
+    return homography
+
+
+def calibrate_pixel_to_cm(camera, homography=None):
+    """
+    互動式校正（--calibrate）：使用共用的攝影機與手部模型，偵測拇指與小指的 pixel 距離，
+    讓使用者輸入真實距離，計算 pixel/cm，並把手掌尺寸存進 profile。
+    有 homography 時，距離在鍵盤平面上量。
+    """
+
+    hands = hand_detector.load_detector()
+    mp_hands, mp_draw = hand_detector.mp_hands, hand_detector.mp_draw
 
     print("📏 請將你的拇指和小指打開，呈現最大張開姿勢")
     print("📸 按 'c' 鍵截圖進行校正")
 
     pixel_distance = None
+    landmarks = None
 
     while True:
-        ret, frame = cap.read() #ret 是回傳是否有抓到照片 frame會是一個矩陣 包含每個pixel的顏色(rgb)
+        ret, frame = camera.read() #ret 是回傳是否有抓到照片 frame會是一個矩陣 包含每個pixel的顏色(rgb)
         if not ret:
             print("❌ 無法讀取攝影機影像")
             break
@@ -54,6 +185,10 @@ def calibrate_pixel_to_cm():
                 cv2.line(frame, thumb_pos, pinky_pos, (0, 255, 0), 2)
 
                 pixel_distance = ((thumb_pos[0] - pinky_pos[0])**2 + (thumb_pos[1] - pinky_pos[1])**2)**0.5
+                landmarks = to_plane(np.array([(lm.x * w, lm.y * h) for lm in hand_landmarks.landmark]),
+                                     homography)
+                if homography is not None:
+                    pixel_distance = float(np.linalg.norm(landmarks[4] - landmarks[20]))
 
                 cv2.putText(frame, f"Pixel Distance: {int(pixel_distance)}", (30, 50),
                             cv2.FONT_HERSHEY_SIMPLEX, 1, (0, 0, 255), 2)    #顯示pixel distance在畫面上
@@ -67,8 +202,8 @@ def calibrate_pixel_to_cm():
             pixel_distance = None
             break
 
-    cap.release()
-    cv2.destroyAllWindows()
+    # 攝影機與模型之後演奏時還要用，只關掉校正視窗
+    cv2.destroyWindow("Calibration")
 
     if pixel_distance is None:
         print("⚠️ 校正失敗，沒有正確取得距離")
@@ -87,5 +222,13 @@ def calibrate_pixel_to_cm():
 
     pixel_per_cm = pixel_distance / true_distance_cm
 
+    # 把這次量到的手掌尺寸存進 profile，之後啟動就能直接自動估計
+    profile = load_profile()
+    profile["hand_span_cm"] = true_distance_cm
+    profile["segments_cm"] = {f"{a}-{b}": float(length / pixel_per_cm)
+                              for (a, b), length in zip(PALM_SEGMENTS, _segment_lengths(landmarks))}
+    profile["pixel_per_cm"] = pixel_per_cm
+    save_profile(profile)
+
     print(f"✅ 校正完成！每公分大約是 {pixel_per_cm:.2f} pixels")
     return pixel_per_cm
@@ -0,0 +1,84 @@
+# camera.py
+import threading
+
+import cv2
+
+
+class CameraSession:
+    """
+    整個程式共用的攝影機連線：校正、解析度偵測與演奏階段都從這裡讀 frame，
+    攝影機只開一次（每次開啟都要花上數百毫秒到數秒）。
+    """
+
+    def __init__(self, index=0):
+        self.index = index
+        self.cap = cv2.VideoCapture(index)
+        self._resolution = None
+        # 背景擷取（start_grabbing 之後）：最新一張 frame 與它的序號
+        self._cond = threading.Condition()
+        self._latest = None
+        self._seq = 0
+        self._consumed = 0
+        self._grabbing = False
+        self._thread = None
+
+    def is_opened(self):
+        return self.cap.isOpened()
+
+    def _read_device(self):
+        ret, frame = self.cap.read()
+        if ret and self._resolution is None:
+            height, width, _ = frame.shape
+            self._resolution = (width, height)
+        return ret, frame
+
+    def read(self):
+        """讀下一張 frame；背景擷取中時等待下一張新的 frame"""
+        if not self._grabbing:
+            return self._read_device()
+        self.wait_frame()
+        return self.latest()
+
+    def start_grabbing(self):
+        """
+        改由背景 thread 持續擷取，手上隨時有最新一張 frame。
+        主迴圈可以在等待新 frame 的同時做別的事（例如檢查壓力），需要時直接取用 latest()。
+        """
+        self._grabbing = True
+        self._thread = threading.Thread(target=self._grab_loop, daemon=True, name="camera_grab")
+        self._thread.start()
+
+    def _grab_loop(self):
+        while self._grabbing:
+            ret, frame = self._read_device()
+            with self._cond:
+                self._latest = (ret, frame)
+                self._seq += 1
+                self._cond.notify_all()
+            if not ret:
+                break
+
+    def wait_frame(self, timeout=None):
+        """等到有還沒取用過的新 frame；逾時回傳 False"""
+        with self._cond:
+            return self._cond.wait_for(lambda: self._seq > self._consumed, timeout)
+
+    def latest(self):
+        """取最新一張已擷取的 frame（不等待新的；一張都還沒有時才等）"""
+        with self._cond:
+            self._cond.wait_for(lambda: self._latest is not None)
+            self._consumed = self._seq
+            return self._latest
+
+    @property
+    def resolution(self):
+        """(width, height)；還沒讀過 frame 時先讀一張"""
+        if self._resolution is None:
+            self.read()
+        return self._resolution if self._resolution is not None else (None, None)
+
+    def release(self):
+        if self._grabbing:
+            self._grabbing = False
+            self._thread.join(timeout=1.0)
+        self.cap.release()
@@ -0,0 +1,70 @@
+# display.py
+import threading
+import time
+
+import cv2
+
+from trace_events import span
+
+WINDOW_NAME = "Piano Glove 🎹"
+DEFAULT_MAX_FPS = 30
+
+
+class DisplayThread:
+    """
+    在獨立 thread 上顯示畫面，讓 cv2.imshow / cv2.waitKey 不卡住音符偵測迴圈。
+    主迴圈只把最新一張 frame 放進單一格的 slot；顯示端來不及時舊 frame 直接丟掉。
+    """
+
+    def __init__(self, window_name=WINDOW_NAME, max_fps=DEFAULT_MAX_FPS):
+        self.window_name = window_name
+        self.min_interval = 1.0 / max_fps if max_fps else 0.0
+        self.quit_requested = False
+        self.shown = 0
+        self.dropped = 0
+        self._frame = None
+        self._cond = threading.Condition()
+        self._running = True
+        self._thread = threading.Thread(target=self._loop, daemon=True, name="display")
+        self._thread.start()
+
+    def show(self, frame):
+        """由主迴圈呼叫：放入最新 frame，永遠不會阻塞"""
+        with self._cond:
+            if self._frame is not None:
+                self.dropped += 1
+            self._frame = frame
+            self._cond.notify()
+
+    def _loop(self):
+        last_shown = 0.0
+        while self._running:
+            with self._cond:
+                while self._frame is None and self._running:
+                    self._cond.wait(timeout=0.1)
+                frame, self._frame = self._frame, None
+            if frame is None:
+                continue
+
+            with span("imshow"):
+                cv2.imshow(self.window_name, frame)
+                self.shown += 1
+                if cv2.waitKey(1) & 0xFF == ord('q'):
+                    self.quit_requested = True
+
+            # 限制顯示頻率，把 CPU 留給偵測迴圈
+            wait = self.min_interval - (time.perf_counter() - last_shown)
+            if wait > 0:
+                time.sleep(wait)
+            last_shown = time.perf_counter()
+
+        # HighGUI 的視窗屬於建立它的 thread，必須在這裡關閉
+        cv2.destroyAllWindows()
+
+    def close(self):
+        """只通知顯示 thread 結束並等待；視窗由顯示 thread 自己關閉"""
+        self._running = False
+        with self._cond:
+            self._cond.notify()
+        self._thread.join(timeout=1.0)
+        print(f"🖥️ 顯示 {self.shown} 張 frame，略過 {self.dropped} 張")
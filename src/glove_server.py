@@ -0,0 +1,200 @@
+# glove_server.py
+import argparse
+import os
+import selectors
+import threading
+import time
+
+import serial
+
+from pressure_reader import (GloveStream, gloves, discover_ports, open_serial,
+                             BAUD_RATE, GLOVE_USB_IDS, HANDSHAKE_TIMEOUT)
+
+READ_SIZE = 4096   # 每次可讀時最多讀多少 bytes
+MAX_LINE = 256     # 累積超過這個長度還沒換行就視為雜訊丟掉
+
+
+class _Device:
+    def __init__(self, stream, ser):
+        self.stream = stream
+        self.ser = ser
+        self.fd = ser.fileno()
+        self.buffer = b""
+        self.bytes = 0
+        self.reads = 0
+        self.overflows = 0
+        self.connected = True
+
+
+class GloveServer:
+    """
+    在單一 thread 上以 selectors（Linux 為 epoll）同時讀取多隻手套。
+    每隻手套仍是一個 GloveStream（解析、時鐘換算、最近壓力的 ring），
+    但不再各自佔一個阻塞在 readline() 的 thread，幾十隻手套也只用一個核心。
+    """
+
+    def __init__(self):
+        self._selector = selectors.DefaultSelector()
+        self._devices = {}  # 名稱（"left" / "right" 或裝置名）→ _Device
+        self._running = False
+        self._thread = None
+
+    def add(self, name, port, baud_rate=BAUD_RATE):
+        """開啟一隻手套並登記到 pressure_reader.gloves；開啟失敗回傳 None"""
+        try:
+            ser = serial.Serial(port, baud_rate, timeout=0)
+        except serial.SerialException:
+            print(f"❌ 無法開啟序列埠 {port}")
+            return None
+        stream = GloveStream(name, port, baud_rate)
+        stream.ser = ser
+        device = _Device(stream, ser)
+        self._devices[name] = device
+        self._selector.register(device.fd, selectors.EVENT_READ, device)
+        gloves[name] = stream
+        return stream
+
+    def start(self):
+        self._running = True
+        self._thread = threading.Thread(target=self._loop, daemon=True, name="glove_server")
+        self._thread.start()
+
+    def _loop(self):
+        while self._running:
+            for key, _ in self._selector.select(timeout=0.5):
+                self._read(key.data)
+
+    def _read(self, device):
+        received = time.perf_counter()
+        try:
+            data = os.read(device.fd, READ_SIZE)
+        except BlockingIOError:
+            return
+        except OSError:
+            data = b""
+        if not data:
+            # 手套被拔掉：停止監看，保留最後的壓力與統計
+            print(f"⚠️ 手套 {device.stream.hand}（{device.stream.port}）已斷線")
+            self._selector.unregister(device.fd)
+            device.connected = False
+            return
+
+        device.bytes += len(data)
+        device.reads += 1
+        *lines, rest = (device.buffer + data).split(b"\n")
+        if len(rest) > MAX_LINE:
+            device.overflows += 1
+            rest = b""
+        device.buffer = rest
+        stream = device.stream
+        for line in lines:
+            stream.feed_line(line.decode("utf-8", "replace").strip(), received)
+
+    def wait_ready(self, timeout=HANDSHAKE_TIMEOUT):
+        """等所有手套送來第一筆資料（共用同一個期限）"""
+        deadline = time.perf_counter() + timeout
+        for device in self._devices.values():
+            device.stream.wait_first_sample(max(0.0, deadline - time.perf_counter()))
+
+    def stats(self):
+        return {
+            name: {
+                "port": device.stream.port,
+                "connected": device.connected,
+                "samples": device.stream.samples,
+                "bad_lines": device.stream.bad_lines,
+                "bytes": device.bytes,
+                "reads": device.reads,
+                "overflows": device.overflows,
+            }
+            for name, device in self._devices.items()
+        }
+
+    def close(self):
+        self._running = False
+        if self._thread is not None:
+            self._thread.join(timeout=1.0)
+            self._thread = None
+        for device in self._devices.values():
+            if device.connected:
+                self._selector.unregister(device.fd)
+            device.ser.close()
+        self._selector.close()
+
+
+def open_gloves(ports, usb_ids=GLOVE_USB_IDS, timeout=HANDSHAKE_TIMEOUT):
+    """
+    開啟 {hand: port} 的手套，port 為 None 的手依 USB VID/PID 自動分配。
+    POSIX 上全部交給一個 GloveServer；其他平台（序列埠不能 select）退回每隻手套一個 thread。
+    回傳 GloveServer 或 None。
+    """
+    ports = dict(ports)
+    found = [port for port in discover_ports(usb_ids) if port not in ports.values()]
+    for hand, port in ports.items():
+        if port is None:
+            if not found:
+                print(f"❌ 找不到 {hand} 手的手套（沒有符合 USB VID/PID 的序列埠）")
+                continue
+            ports[hand] = found.pop(0)
+            print(f"🧤 {hand} 手的手套：{ports[hand]}")
+
+    if os.name != "posix":
+        for hand, port in ports.items():
+            if port is not None:
+                open_serial(port, timeout=timeout, hand=hand)
+        return None
+
+    server = GloveServer()
+    for hand, port in ports.items():
+        if port is not None:
+            server.add(hand, port)
+    server.start()
+    server.wait_ready(timeout)
+    return server
+
+
+def parse_usb_id(text):
+    vid, pid = text.split(":")
+    return int(vid, 16), int(pid, 16)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="同時讀取這台主機上所有手套並顯示統計（教室安裝用）")
+    parser.add_argument("--usb-id", action="append", type=parse_usb_id, default=None, metavar="VID:PID",
+                        help="手套 USB-UART 的 VID:PID（十六進位，可重複指定）")
+    parser.add_argument("--interval", type=float, default=1.0, help="統計輸出間隔（秒）")
+    parser.add_argument("--command", action="append", default=[], metavar="CMD",
+                        help="送給每隻手套韌體的指令，例如 \"RATE 200\"（可重複指定）")
+    args = parser.parse_args()
+
+    ports = discover_ports(args.usb_id or GLOVE_USB_IDS)
+    if not ports:
+        print("⚠️ 找不到任何手套")
+        return
+    server = GloveServer()
+    for port in ports:
+        server.add(os.path.basename(port), port)
+    server.start()
+    for command in args.command:
+        for name in server.stats():
+            print(f"🧤 {name}：{gloves[name].send_command(command)}")
+    print(f"🧤 讀取 {len(ports)} 隻手套，Ctrl+C 結束")
+
+    last = {}
+    try:
+        while True:
+            time.sleep(args.interval)
+            print(f"\n{'手套':<16}{'埠':<16}{'樣本/s':>8}{'壞行':>6}{'溢位':>6}  最新壓力")
+            for name, stat in server.stats().items():
+                rate = (stat["samples"] - last.get(name, 0)) / args.interval
+                last[name] = stat["samples"]
+                state = "" if stat["connected"] else "（斷線）"
+                print(f"{name:<16}{stat['port']:<16}{rate:>8.0f}{stat['bad_lines']:>6}{stat['overflows']:>6}"
+                      f"  {gloves[name].value}{state}")
+    except KeyboardInterrupt:
+        pass
+    server.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -1,14 +1,47 @@
+import threading
+
 import cv2
-import mediapipe as mp
+import numpy as np
+
+from trace_events import traced
+
+# Mediapipe Hands 和繪圖工具只初始化一次；載入很慢，所以延後到 load_detector()，
+# 讓啟動流程可以和攝影機、音訊、序列埠同時進行
+mp_hands = None
+mp_draw = None
+hands = None     # 單手模式（load_detector(max_hands=1)）才會建立
+tracker = None   # 雙手模式（load_detector(max_hands=2)）才會建立
+_load_lock = threading.Lock()
 
-# 一次性初始化 Mediapipe Hands 和繪圖工具
-mp_hands = mp.solutions.hands
-hands = mp_hands.Hands(
-    static_image_mode=False,
-    max_num_hands=1,
-    min_detection_confidence=0.7
-)
-mp_draw = mp.solutions.drawing_utils
+HAND_LABELS = ("left", "right")
+ROI_SCALE = 1.6          # 每隻手的 ROI = 上一個 frame 手部範圍放大的倍數
+ACQUIRE_INTERVAL = 5     # 已追到一隻手時，每幾個 frame 才做一次全畫面偵測找另一隻
+ACQUIRE_SCALE = 0.5      # 全畫面偵測時先縮小影像
+MIN_ROI_SIZE = 64
+
+
+def load_detector(max_hands=1):
+    """
+    載入 Mediapipe 手部模型（重複呼叫只會載入一次）。
+    只建立所用模式需要的模型：max_hands=1 回傳單手的 Hands 物件，max_hands=2 回傳雙手追蹤器。
+    """
+    global mp_hands, hands, mp_draw, tracker
+    with _load_lock:
+        if mp_hands is None:
+            import mediapipe as mp
+            mp_hands = mp.solutions.hands
+            mp_draw = mp.solutions.drawing_utils
+        if max_hands > 1:
+            if tracker is None:
+                tracker = HandTracker()
+            return tracker
+        if hands is None:
+            hands = mp_hands.Hands(
+                static_image_mode=False,
+                max_num_hands=1,
+                min_detection_confidence=0.7
+            )
+    return hands
 
 
 def detect_index_finger_position(frame):
@@ -18,7 +51,7 @@ def detect_index_finger_position(frame):
     """
     # 將 BGR 轉為 RGB 供 Mediapipe 使用
     rgb_frame = cv2.cvtColor(frame, cv2.COLOR_BGR2RGB)
-    result = hands.process(rgb_frame)
+    result = load_detector().process(rgb_frame)
 
     index_position = None
 
@@ -51,21 +84,30 @@ def close_detector():
     """
     釋放 Mediapipe Hands 資源
     """
-    hands.close()
+    global hands, tracker
+    if hands is not None:
+        hands.close()
+        hands = None
+    if tracker is not None:
+        tracker.close()
+        tracker = None
 
-def detect_finger_positions(frame, finger_indices=[8]):
+@traced()
+def detect_finger_positions(frame, finger_indices=[8], landmarks_out=None):
     """
     偵測多隻手的指定手指位置，並在畫面上標示出來。
     
     Parameters:
         frame: 目前攝影機擷取的畫面 (BGR)
         finger_indices: List[int]，欲偵測的 Mediapipe landmark index（預設為食指 = 8）
+        landmarks_out: 若給定 list，會把每隻手全部 21 個 landmark 的 pixel 座標
+                       （shape (21, 2) 的陣列）append 進去，供手掌大小估計使用
     
     Returns:
         List of (x, y) 座標點，依照順序回傳所有符合的手指位置。
     """
     rgb_frame = cv2.cvtColor(frame, cv2.COLOR_BGR2RGB)
-    result = hands.process(rgb_frame)
+    result = load_detector().process(rgb_frame)
 
     positions = []
 
@@ -74,6 +116,8 @@ def detect_finger_positions(frame, finger_indices=[8]):
             mp_draw.draw_landmarks(frame, hand_landmarks, mp_hands.HAND_CONNECTIONS)
 
             h, w, _ = frame.shape
+            if landmarks_out is not None:
+                landmarks_out.append(np.array([(lm.x * w, lm.y * h) for lm in hand_landmarks.landmark]))
             for idx in finger_indices:
                 landmark = hand_landmarks.landmark[idx]
                 x, y = int(landmark.x * w), int(landmark.y * h)
@@ -90,3 +134,134 @@ def detect_finger_positions(frame, finger_indices=[8]):
                             1)
 
     return positions
+
+
+def _draw_hand(frame, points):
+    for a, b in mp_hands.HAND_CONNECTIONS:
+        cv2.line(frame, tuple(points[a]), tuple(points[b]), (255, 255, 255), 2)
+    for point in points:
+        cv2.circle(frame, tuple(point), 3, (0, 0, 255), cv2.FILLED)
+
+
+def _mark_fingers(frame, points, finger_indices, label):
+    positions = []
+    for idx in finger_indices:
+        x, y = int(points[idx][0]), int(points[idx][1])
+        positions.append((x, y))
+        cv2.circle(frame, (x, y), 8, (0, 255, 0), cv2.FILLED)
+        cv2.putText(frame, f"{label[0].upper()}{idx}", (x + 5, y - 5),
+                    cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 255, 0), 1)
+    return positions
+
+
+class _Track:
+    def __init__(self, label, landmarks, model):
+        self.label = label
+        self.landmarks = landmarks  # (21, 2) pixel 座標
+        self.model = model
+
+
+class HandTracker:
+    """
+    雙手偵測與左右手身分追蹤。
+    每隻已追到的手各用一個 Mediapipe 實例，只處理上一個 frame 手部周圍的 ROI；
+    全畫面（縮小後）的偵測只在少於兩隻手時、每 ACQUIRE_INTERVAL 個 frame 做一次。
+    左右手身分在開始追蹤時決定，之後跟著 ROI 走，不會因為單一 frame 的分類跳動而交換。
+    """
+
+    def __init__(self):
+        self._acquirer = mp_hands.Hands(static_image_mode=True, max_num_hands=2,
+                                        min_detection_confidence=0.7)
+        self._free_models = [mp_hands.Hands(static_image_mode=False, max_num_hands=1,
+                                            min_detection_confidence=0.5) for _ in HAND_LABELS]
+        self._tracks = []
+        self._frames_since_acquire = ACQUIRE_INTERVAL
+
+    def detect(self, frame, finger_indices, landmarks_out=None):
+        """回傳 {"left"/"right": [(x, y), ...]}，只包含這個 frame 有偵測到的手"""
+        for track in list(self._tracks):
+            if not self._follow(track, frame):
+                self._drop(track)
+        # 兩個 ROI 跟到同一隻手時只留先開始追蹤的那個
+        if len(self._tracks) == 2 and self._contains(self._tracks[0], self._tracks[1].landmarks.mean(axis=0)):
+            self._drop(self._tracks[1])
+
+        self._frames_since_acquire += 1
+        if len(self._tracks) < len(HAND_LABELS) and (
+                not self._tracks or self._frames_since_acquire >= ACQUIRE_INTERVAL):
+            self._frames_since_acquire = 0
+            self._acquire(frame)
+
+        result = {}
+        for track in self._tracks:
+            points = track.landmarks.astype(np.int32)
+            _draw_hand(frame, points)
+            result[track.label] = _mark_fingers(frame, points, finger_indices, track.label)
+            if landmarks_out is not None:
+                landmarks_out.append(track.landmarks)
+        return result
+
+    def _follow(self, track, frame):
+        """在 ROI 內重新偵測這隻手；跟丟時回傳 False"""
+        h, w, _ = frame.shape
+        (x_min, y_min), (x_max, y_max) = track.landmarks.min(axis=0), track.landmarks.max(axis=0)
+        half = max(x_max - x_min, y_max - y_min, MIN_ROI_SIZE) * ROI_SCALE / 2
+        cx, cy = (x_min + x_max) / 2, (y_min + y_max) / 2
+        x0, y0 = int(max(0, cx - half)), int(max(0, cy - half))
+        x1, y1 = int(min(w, cx + half)), int(min(h, cy + half))
+        if x1 - x0 < MIN_ROI_SIZE // 2 or y1 - y0 < MIN_ROI_SIZE // 2:
+            return False
+
+        roi = cv2.cvtColor(frame[y0:y1, x0:x1], cv2.COLOR_BGR2RGB)
+        result = track.model.process(roi)
+        if not result.multi_hand_landmarks:
+            return False
+        landmarks = result.multi_hand_landmarks[0].landmark
+        track.landmarks = np.array([(x0 + lm.x * (x1 - x0), y0 + lm.y * (y1 - y0)) for lm in landmarks])
+        return True
+
+    def _acquire(self, frame):
+        h, w, _ = frame.shape
+        small = cv2.resize(frame, None, fx=ACQUIRE_SCALE, fy=ACQUIRE_SCALE, interpolation=cv2.INTER_AREA)
+        result = self._acquirer.process(cv2.cvtColor(small, cv2.COLOR_BGR2RGB))
+        if not result.multi_hand_landmarks:
+            return
+        for hand_landmarks, handedness in zip(result.multi_hand_landmarks, result.multi_handedness):
+            if not self._free_models:
+                break
+            landmarks = np.array([(lm.x * w, lm.y * h) for lm in hand_landmarks.landmark])
+            center = landmarks.mean(axis=0)
+            if any(self._contains(track, center) for track in self._tracks):
+                continue  # 已經在追的手
+            # 畫面已水平翻轉，Mediapipe 的 Left/Right 即使用者實際的左右手
+            label = handedness.classification[0].label.lower()
+            taken = {track.label for track in self._tracks}
+            if label in taken:
+                label = next(other for other in HAND_LABELS if other not in taken)
+            self._tracks.append(_Track(label, landmarks, self._free_models.pop()))
+
+    def _drop(self, track):
+        self._tracks.remove(track)
+        self._free_models.append(track.model)
+
+    @staticmethod
+    def _contains(track, point):
+        (x_min, y_min), (x_max, y_max) = track.landmarks.min(axis=0), track.landmarks.max(axis=0)
+        return x_min <= point[0] <= x_max and y_min <= point[1] <= y_max
+
+    def close(self):
+        self._acquirer.close()
+        for model in self._free_models + [track.model for track in self._tracks]:
+            model.close()
+
+
+@traced()
+def detect_hands(frame, finger_indices=[8], landmarks_out=None):
+    """
+    偵測每隻手的指定手指位置，回傳 {手: [(x, y), ...]}。
+    雙手模式由 HandTracker 追蹤左右手；單手模式沿用 detect_finger_positions，手的標籤固定為 "right"。
+    """
+    if tracker is not None:
+        return tracker.detect(frame, finger_indices, landmarks_out)
+    positions = detect_finger_positions(frame, finger_indices, landmarks_out)
+    return {"right": positions} if positions else {}
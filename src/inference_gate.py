@@ -0,0 +1,53 @@
+# inference_gate.py
+import time
+
+IDLE_INFERENCE_HZ = 5   # 所有手指都沒按壓時，手部追蹤降到這個頻率
+IDLE_HOLD = 0.5         # 最後一次按壓後維持全速多久（秒），避免兩個音之間掉回閒置
+POLL_INTERVAL = 0.003   # 閒置時等待新 frame 期間，檢查壓力的間隔（秒）
+
+
+class InferenceGate:
+    """
+    依手套壓力決定這個 frame 要不要跑手部推論。
+    只有壓力超過門檻的 frame 才可能發出聲音，所以沒有手指按壓時只以低頻率追蹤手的位置；
+    一出現按壓就回到每個 frame 都推論。
+    """
+
+    def __init__(self, pressed_fn, idle_hz=IDLE_INFERENCE_HZ, hold=IDLE_HOLD, clock=time.perf_counter):
+        self.pressed_fn = pressed_fn
+        self.idle_period = 1.0 / idle_hz
+        self.hold = hold
+        self.clock = clock
+        self._last_pressed = None
+        self._last_inference = None
+        self.frames = 0
+        self.inferred = 0
+
+    @property
+    def idle(self):
+        if self.pressed_fn():
+            self._last_pressed = self.clock()
+            return False
+        return self._last_pressed is None or self.clock() - self._last_pressed > self.hold
+
+    def wait_frame(self, camera):
+        """
+        等下一張 frame。閒置時一邊等一邊檢查壓力：一出現按壓就不再等，
+        直接用背景擷取手上最新的 frame，第一個音不必多等一個 frame 週期。
+        """
+        if not self.idle:
+            camera.wait_frame()
+            return camera.latest()
+        while not camera.wait_frame(POLL_INTERVAL):
+            if not self.idle:
+                break  # 按壓 onset
+        return camera.latest()
+
+    def should_infer(self):
+        self.frames += 1
+        now = self.clock()
+        if self.idle and self._last_inference is not None and now - self._last_inference < self.idle_period:
+            return False
+        self._last_inference = now
+        self.inferred += 1
+        return True
@@ -0,0 +1,134 @@
+# keyboard_overlay.py
+import cv2
+import numpy as np
+
+from trace_events import traced
+
+ALPHA = 0.4
+BLACK_KEY_RATIO = 0.6
+IDLE_WHITE = (230, 230, 230)
+IDLE_BLACK = (0, 0, 0)
+
+
+def white_key_color(volume):
+    if volume is None:
+        return IDLE_WHITE
+    brightness = int(60 + volume * 40)
+    return (180, 180, brightness)
+
+
+def black_key_color(volume):
+    if volume is None:
+        return IDLE_BLACK
+    brightness = int(40 + volume * 80)
+    return (brightness, brightness, brightness)
+
+
+class KeyboardOverlay:
+    """
+    快取的鍵盤圖層。鍵盤幾何在 generate_keyboard_mapping 之後就不會變，
+    所以只在建立時畫一次完整的閒置鍵盤，之後每個 frame 只重畫顏色有變的琴鍵，
+    並且只對鍵盤涵蓋的水平範圍做 alpha 混合。
+    有 homography（影像 → 鍵盤平面）時，琴鍵畫在鍵盤平面上，只有顏色改變時才投影回影像一次。
+    """
+
+    def __init__(self, white_keys, black_keys, screen_width, screen_height, alpha=ALPHA,
+                 homography=None):
+        self.white_keys = white_keys
+        self.black_keys = black_keys
+        self.height = screen_height
+        self.black_height = int(screen_height * BLACK_KEY_RATIO)
+        self.alpha = alpha
+
+        lefts = [key["left"] for key in white_keys + black_keys]
+        rights = [key["right"] for key in white_keys + black_keys]
+        self.x0 = max(0, min(lefts)) if lefts else 0
+        self.x1 = min(screen_width, max(rights) + 1) if rights else 0
+
+        self.origin = self.x0  # 鍵盤平面上圖層左緣的 x
+        self.plane = np.zeros((screen_height, self.x1 - self.x0, 3), dtype=np.uint8)
+        self.layer = self.plane
+        self.mask = None
+        self._colors = {}  # note → 目前圖層上的顏色
+
+        # 黑鍵蓋在白鍵上方；重畫白鍵時要一併補畫與它重疊的黑鍵
+        self._overlapping_black = {
+            w["note"]: [b for b in black_keys if b["left"] <= w["right"] and b["right"] >= w["left"]]
+            for w in white_keys
+        }
+
+        for key in white_keys:
+            self._draw_white(key, IDLE_WHITE)
+        for key in black_keys:
+            self._draw_black(key, IDLE_BLACK)
+
+        if homography is not None:
+            self._init_projection(np.asarray(homography, dtype=np.float64), screen_width)
+
+    def _init_projection(self, homography, screen_width):
+        width = self.plane.shape[1]
+        shift = np.array([[1, 0, self.origin], [0, 1, 0], [0, 0, 1]], dtype=np.float64)
+        to_image = np.linalg.inv(homography) @ shift  # 圖層座標 → 影像座標
+        corners = np.float32([[[0, 0]], [[width, 0]], [[width, self.height]], [[0, self.height]]])
+        xs = cv2.perspectiveTransform(corners, to_image)[:, 0, 0]
+        self.x0 = int(np.clip(np.floor(xs.min()), 0, screen_width))
+        self.x1 = int(np.clip(np.ceil(xs.max()) + 1, self.x0, screen_width))
+        unshift = np.array([[1, 0, -self.x0], [0, 1, 0], [0, 0, 1]], dtype=np.float64)
+        self._projection = unshift @ to_image
+        self._size = (self.x1 - self.x0, self.height)
+        self.layer = np.zeros((self.height, self.x1 - self.x0, 3), dtype=np.uint8)
+        ones = np.full(self.plane.shape[:2], 255, dtype=np.uint8)
+        self.mask = cv2.warpPerspective(ones, self._projection, self._size)[:, :, None] > 0
+        self._project()
+
+    def _project(self):
+        cv2.warpPerspective(self.plane, self._projection, self._size, dst=self.layer)
+
+    def _draw_white(self, key, color):
+        left, right = key["left"] - self.origin, key["right"] - self.origin
+        cv2.rectangle(self.plane, (left, 0), (right, self.height), color, -1)
+        cv2.rectangle(self.plane, (left, 0), (right, self.height), (0, 0, 0), 1)
+        center = (left + right) // 2
+        cv2.putText(self.plane, key["note"], (center - 15, self.height - 10),
+                    cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 0, 0), 1)
+        self._colors[key["note"]] = color
+
+    def _draw_black(self, key, color):
+        left, right = key["left"] - self.origin, key["right"] - self.origin
+        cv2.rectangle(self.plane, (left, 0), (right, self.black_height), color, -1)
+        center = (left + right) // 2
+        cv2.putText(self.plane, key["note"], (center - 15, self.black_height - 10),
+                    cv2.FONT_HERSHEY_SIMPLEX, 0.4, (255, 255, 255), 1)
+        self._colors[key["note"]] = color
+
+    @traced("overlay_update")
+    def update(self, flash_keys):
+        """依 flash_keys（note → (time, volume)）只重畫顏色有變的琴鍵"""
+        redraw_black = set()
+        changed = False
+        for key in self.white_keys:
+            entry = flash_keys.get(key["note"])
+            color = white_key_color(entry[1] if entry else None)
+            if self._colors.get(key["note"]) != color:
+                self._draw_white(key, color)
+                redraw_black.update(b["note"] for b in self._overlapping_black[key["note"]])
+                changed = True
+        for key in self.black_keys:
+            entry = flash_keys.get(key["note"])
+            color = black_key_color(entry[1] if entry else None)
+            if self._colors.get(key["note"]) != color or key["note"] in redraw_black:
+                self._draw_black(key, color)
+                changed = True
+        if changed and self.mask is not None:
+            self._project()
+
+    @traced("overlay_blend")
+    def blend(self, frame):
+        """只在鍵盤範圍內把圖層疊到 frame 上（原地修改）"""
+        region = frame[:, self.x0:self.x1]
+        if self.mask is None:
+            cv2.addWeighted(self.layer, self.alpha, region, 1 - self.alpha, 0, region)
+        else:
+            # 斜拍時鍵盤是梯形，只混合梯形內的 pixel
+            blended = cv2.addWeighted(self.layer, self.alpha, region, 1 - self.alpha, 0)
+            np.copyto(region, blended, where=self.mask)
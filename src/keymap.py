@@ -0,0 +1,68 @@
+# keymap.py
+import threading
+
+from keyboard_overlay import KeyboardOverlay
+from new_screen_mapper import generate_keyboard_mapping, NoteLUT
+
+REBUILD_THRESHOLD = 0.08  # pixel/cm 相對變化超過 8% 才重建鍵盤
+
+
+class Keymap:
+    """一組建好就不再修改的鍵盤：琴鍵範圍、每個 pixel 的音符查表與對應的快取圖層"""
+
+    def __init__(self, pixel_per_cm, screen_width, screen_height, homography=None):
+        self.pixel_per_cm = pixel_per_cm
+        self.white_keys, self.black_keys, self.lowest_note, self.highest_note = \
+            generate_keyboard_mapping(screen_width, pixel_per_cm)
+        self.lut = NoteLUT(self.white_keys, self.black_keys, screen_width, screen_height, homography)
+        self.overlay = KeyboardOverlay(self.white_keys, self.black_keys, screen_width, screen_height,
+                                       homography=homography)
+
+    @property
+    def notes(self):
+        return [key["note"] for key in self.white_keys + self.black_keys]
+
+
+class AdaptiveKeymap:
+    """
+    讓鍵盤寬度跟著手掌的遠近調整。
+    新的 Keymap 在背景 thread 建好（包含圖層與新音符的預載）之後才以一次參照賦值換上，
+    主迴圈每個 frame 讀一次 current，拿到的永遠是完整的一組鍵盤。
+    """
+
+    def __init__(self, pixel_per_cm, screen_width, screen_height, homography=None,
+                 threshold=REBUILD_THRESHOLD, on_build=None):
+        self.screen_width = screen_width
+        self.screen_height = screen_height
+        self.homography = homography
+        self.threshold = threshold
+        self.on_build = on_build  # 新 Keymap 換上前呼叫，例如預載新出現的音符
+        self.rebuilds = 0
+        self.current = Keymap(pixel_per_cm, screen_width, screen_height, homography)
+        self._building = False
+        self._lock = threading.Lock()
+
+    def update(self, pixel_per_cm):
+        """餵入最新的 pixel/cm 估計；變化夠大且沒有正在重建時才在背景重建，不會阻塞"""
+        if pixel_per_cm is None:
+            return
+        change = abs(pixel_per_cm - self.current.pixel_per_cm) / self.current.pixel_per_cm
+        if change < self.threshold:
+            return
+        with self._lock:
+            if self._building:
+                return
+            self._building = True
+        threading.Thread(target=self._build, args=(pixel_per_cm,), daemon=True,
+                         name="keymap_build").start()
+
+    def _build(self, pixel_per_cm):
+        try:
+            keymap = Keymap(pixel_per_cm, self.screen_width, self.screen_height, self.homography)
+            if self.on_build is not None:
+                self.on_build(keymap)
+            self.current = keymap
+            self.rebuilds += 1
+        finally:
+            with self._lock:
+                self._building = False
@@ -0,0 +1,112 @@
+# latency_trace.py
+import atexit
+import collections
+import itertools
+import signal
+import threading
+import time
+
+import numpy as np
+
+# 一個音符事件經過的階段；時間一律使用 time.perf_counter()
+STAGES = ["adc", "serial_rx", "capture", "inference", "decision", "audio_out"]
+# 壓力與影像兩條路徑平行進行，在 decision 會合後共用 decision → audio_out；
+# 各階段延遲只在同一條路徑內相減
+PATHS = {
+    "壓力": ["adc", "serial_rx", "decision"],
+    "影像": ["capture", "inference", "decision"],
+}
+MAX_SAMPLES = 10000   # 每個 histogram 最多保留的樣本數
+MAX_PENDING = 256     # 尚未等到 audio_out 的事件上限，超過就丟掉最舊的
+
+
+class LatencyTracer:
+    """
+    把每個音符事件在各階段的時間戳串起來：壓力（ADC → 序列埠）與影像（攝影機 → 推論）兩條路徑
+    在判斷處會合，再到音訊輸出。事件完成後分別累積兩條路徑各階段與總延遲的分佈，
+    可在結束時或收到 SIGUSR1 時輸出 p50 / p99 / max。
+    SIGUSR1 只設旗標，由主迴圈呼叫 poll() 時輸出，signal handler 裡不碰鎖也不印東西。
+    """
+
+    def __init__(self):
+        self.enabled = False
+        self._ids = itertools.count(1)
+        self._pending = collections.OrderedDict()
+        self._samples = collections.defaultdict(lambda: collections.deque(maxlen=MAX_SAMPLES))
+        self._lock = threading.Lock()
+        self._dump_requested = False
+
+    def enable(self, dump_on_exit=True):
+        self.enabled = True
+        if dump_on_exit:
+            atexit.register(self.dump)
+        if hasattr(signal, "SIGUSR1"):
+            signal.signal(signal.SIGUSR1, self._request_dump)
+
+    def _request_dump(self, signum, frame):
+        self._dump_requested = True
+
+    def poll(self):
+        """主迴圈每圈呼叫：收到過 SIGUSR1 就在這裡輸出統計"""
+        if self._dump_requested:
+            self._dump_requested = False
+            self.dump()
+
+    def new_event(self, note, **stamps):
+        """建立一個事件並記下已知階段的時間，回傳事件 id（未啟用時回傳 None）"""
+        if not self.enabled:
+            return None
+        event_id = next(self._ids)
+        with self._lock:
+            self._pending[event_id] = {stage: t for stage, t in stamps.items() if t is not None}
+            if len(self._pending) > MAX_PENDING:
+                self._pending.popitem(last=False)
+        return event_id
+
+    def mark(self, event_id, stage, t=None):
+        """補上某個階段的時間；標到最後一個階段時事件完成並計入統計"""
+        if event_id is None:
+            return
+        t = time.perf_counter() if t is None else t
+        with self._lock:
+            stamps = self._pending.get(event_id)
+            if stamps is None:
+                return
+            stamps[stage] = t
+            if stage != STAGES[-1]:
+                return
+            del self._pending[event_id]
+            for path, stages in PATHS.items():
+                ordered = [(s, stamps[s]) for s in stages + [STAGES[-1]] if s in stamps]
+                if len(ordered) < 2 or ordered[0][0] not in stages[:-1]:
+                    continue  # 這個事件沒有這條路徑的時間戳
+                for (prev_stage, prev_t), (cur_stage, cur_t) in zip(ordered[:-1], ordered[1:-1]):
+                    self._samples[f"{path} {prev_stage}→{cur_stage}"].append(cur_t - prev_t)
+                self._samples[f"total({ordered[0][0]}→{STAGES[-1]})"].append(t - ordered[0][1])
+            if "decision" in stamps:
+                self._samples[f"decision→{STAGES[-1]}"].append(t - stamps["decision"])
+
+    def summary(self):
+        """回傳 {名稱: (count, p50_ms, p99_ms, max_ms)}"""
+        with self._lock:
+            snapshot = {name: np.array(values) for name, values in self._samples.items() if values}
+        result = {}
+        for name, values in snapshot.items():
+            ms = values * 1000
+            result[name] = (len(ms), float(np.percentile(ms, 50)), float(np.percentile(ms, 99)), float(ms.max()))
+        return result
+
+    def dump(self):
+        summary = self.summary()
+        if not summary:
+            print("⏱️ 沒有完成的延遲樣本")
+            return
+        print("⏱️ 延遲統計（ms）")
+        print(f"{'階段':<28}{'次數':>8}{'p50':>10}{'p99':>10}{'max':>10}")
+        for name in sorted(summary, key=lambda n: (n.startswith("total"), n)):
+            count, p50, p99, peak = summary[name]
+            print(f"{name:<28}{count:>8}{p50:>10.2f}{p99:>10.2f}{peak:>10.2f}")
+
+
+# 全域共用的 tracer，main.py 以 --trace-latency 啟用
+tracer = LatencyTracer()
@@ -1,148 +1,306 @@
-from calibration import calibrate_pixel_to_cm
-from new_screen_mapper import generate_keyboard_mapping, find_note_by_position
-from hand_detector import close_detector, detect_finger_positions
+import time
+_PROCESS_START = time.perf_counter()  # 計算 time-to-first-note 的起點
+
+from calibration import (calibrate_pixel_to_cm, calibrate_homography, load_profile, save_profile,
+                         HandSpanEstimator)
+from new_screen_mapper import WHITE_KEY_CM
+from note_controller import NoteController, FINGER_INDICES
+from keymap import AdaptiveKeymap
+from display import DisplayThread
+from camera import CameraSession
+from hand_detector import close_detector, detect_hands, load_detector
 from new_sound_manager import SoundManager
-from pressure_reader import get_finger_pressure
+from sampled_instrument import SampledInstrument
+from pressure_reader import (get_finger_pressure, get_sample_times, get_calibration, any_pressed, gloves,
+                            PressureCalibration,
+                            SERIAL_PORT, PRIMARY_HAND, GLOVE_USB_IDS)
+from onset_predictor import OnsetPredictor
+from inference_gate import InferenceGate
+from glove_server import open_gloves, parse_usb_id
+from latency_trace import tracer
+from startup import StartupGraph
+import trace_events
 
+import argparse
 import cv2
-import time
+import numpy as np
 
-def get_camera_resolution():
-    cap = cv2.VideoCapture(0)
-    if not cap.isOpened():
+DEFAULT_WHITE_KEYS = 14  # 沒有任何校正資料時，先讓畫面放得下這麼多白鍵
+
+def get_camera_resolution(camera):
+    if not camera.is_opened():
         print("❌ 無法開啟攝影機")
         return None, None
-    ret, frame = cap.read()
-    if not ret:
+    width, height = camera.resolution
+    if width is None:
         print("❌ 無法讀取攝影機影像")
-        cap.release()
-        return None, None
-    height, width, _ = frame.shape
-    cap.release()
     return width, height
 
+def parse_args():
+    parser = argparse.ArgumentParser(description="Piano Glove")
+    parser.add_argument("--audio-backend", default="portaudio",
+                        choices=["portaudio", "alsa", "jack", "null"],
+                        help="音訊輸出後端（null 不出聲，用於 headless 測試）")
+    parser.add_argument("--period-size", type=int, default=256,
+                        help="每個音訊 period 的 frame 數（最小 64）")
+    parser.add_argument("--periods", type=int, default=2,
+                        help="音訊 buffer 內的 period 數")
+    parser.add_argument("--max-voices", type=int, default=10,
+                        help="同時發聲的 voice 上限，超過時會搶佔")
+    parser.add_argument("--steal", default="oldest", choices=["oldest", "quietest"],
+                        help="超過 voice 上限時要搶走哪一個 voice")
+    parser.add_argument("--midi", action="store_true",
+                        help="不在本機合成，改把音符與壓力送到 ALSA sequencer port")
+    parser.add_argument("--samples", default=None,
+                        help="鋼琴取樣來源：WAV 資料夾（如 C4_v64.wav）或 .sf2 檔；未指定時使用正弦波")
+    parser.add_argument("--headless", action="store_true",
+                        help="完全關閉畫面顯示（benchmark / kiosk 用），以 Ctrl+C 結束")
+    parser.add_argument("--pixel-per-cm", type=float, default=None,
+                        help="直接指定 pixel/cm 並略過校正")
+    parser.add_argument("--calibrate", action="store_true",
+                        help="啟動時先用互動視窗校正（按 c 截圖、輸入實際距離），結果存進 profile")
+    parser.add_argument("--perspective", action="store_true",
+                        help="啟動時點選鍵盤區域四個角，校正斜拍的鏡頭角度，結果存進 profile")
+    parser.add_argument("--flat", action="store_true",
+                        help="忽略 profile 裡的鏡頭角度校正，視為鏡頭正對桌面")
+    parser.add_argument("--hand-span", type=float, default=None, metavar="CM",
+                        help="拇指到小指張開的實際距離（cm），存進 profile 供自動校正使用")
+    parser.add_argument("--trace-latency", action="store_true",
+                        help="記錄每個音符從 ADC 到音訊輸出的各階段延遲，結束時（或收到 SIGUSR1）輸出統計")
+    parser.add_argument("--trace-events", default=None, metavar="PATH",
+                        help="把主迴圈與各 thread 的時間軸寫成 Chrome trace JSON（可用 Perfetto 開啟）")
+    parser.add_argument("--glove-port", default=SERIAL_PORT,
+                        help="手套（單手模式）或右手手套的序列埠；未指定時依 USB VID/PID 自動尋找")
+    parser.add_argument("--left-glove-port", default=None,
+                        help="左手手套的序列埠；指定後啟用雙手、十指模式")
+    parser.add_argument("--hands", type=int, default=1, choices=[1, 2],
+                        help="2 = 雙手、十指模式（未指定序列埠的手套會自動尋找）")
+    parser.add_argument("--glove-usb-id", action="append", type=parse_usb_id, default=None,
+                        metavar="VID:PID", help="自動尋找手套時比對的 USB VID:PID（可重複指定）")
+    parser.add_argument("--power-save", action="store_true",
+                        help="沒有手指按壓時降低手部推論頻率以節省 CPU，一按壓立即回到全速")
+    parser.add_argument("--predict-onset", action="store_true",
+                        help="以壓力斜率與指尖速度預測按鍵：預先備妥 voice，壓力一越過門檻就立即發聲")
+    parser.add_argument("--glove-command", action="append", default=[], metavar="CMD",
+                        help="開始前送給每隻手套韌體的指令，例如 \"RATE 200\"、\"AVG 4\"（可重複指定）")
+    parser.add_argument("--pressure-calibrate", action="store_true",
+                        help="啟動時量測每根手指的壓力基準、雜訊與最大值，結果存進 profile")
+    parser.add_argument("--key-margin", type=int, default=8,
+                        help="手指要離開目前的琴鍵超過幾個 pixel 才換鍵（0 = 不做遲滯）")
+    parser.add_argument("--display-fps", type=int, default=30,
+                        help="畫面顯示的最高更新率")
+    return parser.parse_args()
+
 def main():
+    args = parse_args()
+    if args.trace_latency:
+        tracer.enable()
+    if args.trace_events:
+        trace_events.enable(args.trace_events)
     print("🎹 Piano Glove 系統啟動中...")
 
-    print("\n[步驟1] 啟動手指長度校正")
-    pixel_per_cm = calibrate_pixel_to_cm()
-    if pixel_per_cm is None:
-        print("⚠️ 校正失敗，程式結束")
-        return
+    # 啟動流程以相依圖執行：攝影機、手部模型、序列埠、取樣載入與音訊裝置同時初始化，
+    # 校正需要攝影機與模型，音效預載需要鍵盤 mapping 與音訊裝置
+    graph = StartupGraph()
+    graph.add("camera", lambda: CameraSession(0), cleanup=lambda camera: camera.release())
+    two_hands = args.hands == 2 or args.left_glove_port is not None
+    glove_ports = {"right": args.glove_port}
+    if two_hands:
+        glove_ports["left"] = args.left_glove_port
+    graph.add("detector", lambda: load_detector(max_hands=2 if two_hands else 1),
+              cleanup=lambda _: close_detector())
+    graph.add("gloves", lambda: open_gloves(glove_ports, usb_ids=args.glove_usb_id or GLOVE_USB_IDS),
+              cleanup=lambda server: server is not None and server.close())
+    graph.add("instrument", lambda: SampledInstrument(args.samples) if args.samples else None)
+    if args.midi:
+        from midi_output import MidiOutput
+        graph.add("audio", MidiOutput, cleanup=lambda midi: midi.close())
+    else:
+        graph.add("audio", lambda instrument: SoundManager(
+            backend=args.audio_backend, period_size=args.period_size, periods=args.periods,
+            instrument=instrument, max_voices=args.max_voices, steal=args.steal),
+            deps=["instrument"], cleanup=lambda sound_manager: sound_manager.close())
+
+    # 攝影機只開一次，校正、解析度偵測與演奏共用
+    camera = graph.result("camera")
 
-    print("\n[步驟2] 自動偵測畫面大小")
-    screen_width, screen_height = get_camera_resolution()
+    print("\n[步驟1] 自動偵測畫面大小")
+    screen_width, screen_height = get_camera_resolution(camera)
     if screen_width is None:
+        graph.abort()
         return
 
+    print("\n[步驟2] 鏡頭角度與手掌大小校正")
+    profile = load_profile()
+    if args.hand_span is not None:
+        profile["hand_span_cm"] = args.hand_span
+        save_profile(profile)
+    homography = None
+    if args.perspective and not args.headless:
+        homography = calibrate_homography(camera, screen_width, screen_height)
+        profile = load_profile()
+    elif "homography" in profile and not args.flat:
+        homography = np.array(profile["homography"], dtype=np.float64)
+        print("📐 使用 profile 中的鏡頭角度校正（--flat 可忽略）")
+    estimator = None
+    if args.pixel_per_cm is not None:
+        pixel_per_cm = args.pixel_per_cm
+    elif args.calibrate:
+        if args.headless:
+            print("⚠️ headless 模式無法互動校正")
+            graph.abort()
+            return
+        # 校正視窗必須在主 thread 上執行
+        graph.result("detector")
+        pixel_per_cm = calibrate_pixel_to_cm(camera, homography)
+        if pixel_per_cm is None:
+            print("⚠️ 校正失敗，程式結束")
+            graph.abort()
+            return
+        profile = load_profile()
+    else:
+        # 不等校正：先用上次的結果（或依畫面寬度估一個）讓鍵盤立刻可以彈，演奏中再自動修正
+        pixel_per_cm = profile.get("pixel_per_cm") or screen_width / (DEFAULT_WHITE_KEYS * WHITE_KEY_CM)
+        estimator = HandSpanEstimator(profile, homography=homography)
+        print(f"✋ 演奏中自動校正（暫用 {pixel_per_cm:.2f} pixels/cm）")
+
     print("\n[步驟3] 產生鍵盤 mapping")
-    white_keys, black_keys, lowest_note, highest_note = generate_keyboard_mapping(screen_width, pixel_per_cm)
+    keymaps = AdaptiveKeymap(pixel_per_cm, screen_width, screen_height, homography)
+    keymap = keymaps.current
 
     print("\n[步驟4] 載入音效合成器")
-    sound_manager = SoundManager()
-
-    # ✨ 新增：預先生成畫面中所有可用 note 的 waveform
-    all_notes_on_screen = [key["note"] for key in white_keys + black_keys]
-    sound_manager.preload_notes(all_notes_on_screen)
+    # ✨ 預先生成畫面中所有可用 note 的 waveform（背景執行，同時建立鍵盤圖層）
+    all_notes_on_screen = keymap.notes
+    graph.add("preload", lambda sound_manager: sound_manager.preload_notes(all_notes_on_screen),
+              deps=["audio"])
 
     print("\n[步驟5] 開始畫面與偵測")
-    cap = cv2.VideoCapture(0)
-    flash_keys = {}  # note → (time, volume)
-
-    finger_indices = [4, 8, 12, 16, 20]
-    finger_map = {4: 0, 8: 1, 12: 2, 16: 3, 20: 4}
-    active_notes = set()  # 當前正在播放的 note 集合
-
-    while True:
-        ret, frame = cap.read()
-        if not ret:
-            break
-        frame = cv2.flip(frame, 1)
-        current_time = time.time()
-
-        finger_positions = detect_finger_positions(frame, finger_indices=finger_indices)
-        current_notes = set()
-
-        if finger_positions:
-            for landmark_index, (x, y) in zip(finger_indices, finger_positions):
-                note = find_note_by_position(x, y, white_keys, black_keys, screen_height)
-                pressure_index = finger_map.get(landmark_index)
-
-                if note and pressure_index is not None:
-                    current_notes.add(note)
-                    pressure = get_finger_pressure(pressure_index)
-                    volume = min(1.0, (pressure - 10) / (100.0 - 20.0))
-
-                    if pressure > 20:
-                        sound_manager.volumes[note] = volume 
-                        
-                        if note not in active_notes:
-                            sound_manager.play_note(note, volume=volume)
-                            active_notes.add(note)
-                        else:
-                            pass
-                        flash_keys[note] = (current_time, volume)
-                    else:
-                        if note in active_notes:
-                            sound_manager.stop_note(note)
-                            active_notes.remove(note)
-
-        # 偵測離開畫面或未按壓者，停止播放
-        for note in list(active_notes):
-            if note not in current_notes:
-                sound_manager.stop_note(note)
-                active_notes.remove(note)
-
-        # 清除過期的閃燈
-        for note in list(flash_keys.keys()):
-            timestamp, _ = flash_keys[note]
-            if current_time - timestamp >= 0.3:
-                del flash_keys[note]
-
-        # === 建立 overlay 圖層 ===
-        overlay = frame.copy()
-
-        for key in white_keys:
-            note = key["note"]
-            if note in flash_keys:
-                _, volume = flash_keys[note]
-                brightness = int(60 + volume * 40)
-                color = (180, 180, brightness)
-            else:
-                color = (230, 230, 230)
-
-            cv2.rectangle(overlay, (key["left"], 0), (key["right"], screen_height), color, -1)
-            cv2.rectangle(overlay, (key["left"], 0), (key["right"], screen_height), (0, 0, 0), 1)
-            center = (key["left"] + key["right"]) // 2
-            cv2.putText(overlay, note, (center - 15, screen_height - 10),
-                        cv2.FONT_HERSHEY_SIMPLEX, 0.5, (0, 0, 0), 1)
-
-        for key in black_keys:
-            note = key["note"]
-            if note in flash_keys:
-                _, volume = flash_keys[note]
-                brightness = int(40 + volume * 80)
-                color = (brightness, brightness, brightness)
-            else:
-                color = (0, 0, 0)
-
-            cv2.rectangle(overlay, (key["left"], 0), (key["right"], int(screen_height * 0.6)), color, -1)
-            center = (key["left"] + key["right"]) // 2
-            cv2.putText(overlay, note, (center - 15, int(screen_height * 0.6) - 10),
-                        cv2.FONT_HERSHEY_SIMPLEX, 0.4, (255, 255, 255), 1)
-
-        # 疊加 overlay
-        alpha = 0.4
-        cv2.addWeighted(overlay, alpha, frame, 1 - alpha, 0, frame)
-
-        # 顯示畫面
-        cv2.imshow("Piano Glove 🎹", frame)
-        if cv2.waitKey(1) & 0xFF == ord('q'):
-            break
-
-    cap.release()
-    cv2.destroyAllWindows()
+    display = None if args.headless else DisplayThread(max_fps=args.display_fps)
+    graph.result("detector")
+    glove_server = graph.result("gloves")
+    graph.result("preload")
+    sound_manager = graph.result("audio")
+    graph.shutdown()
+    graph.report(_PROCESS_START)
+    print(f"🎵 time-to-first-note：{(time.perf_counter() - _PROCESS_START) * 1000:.0f} ms")
+    # 鍵盤隨手掌遠近重建時，順便預載新出現的音符
+    keymaps.on_build = lambda new_keymap: sound_manager.preload_notes(new_keymap.notes)
+
+    # 每根手指的壓力量程：--pressure-calibrate 重新量測，否則沿用 profile 裡的（之後持續追蹤漂移）
+    # 以 cN 記錄；舊版（韌體送原始讀數時）的 "pressure" 不再沿用
+    pressure_profile = profile.setdefault("pressure_cn", {})
+    for hand, glove in gloves.items():
+        # 先調整韌體（取樣率、平均次數…），之後的壓力校正才會量到實際演奏時的數值
+        for command in args.glove_command:
+            reply = glove.send_command(command)
+            if reply is not None and reply.startswith("OK"):
+                print(f"🧤 {hand}：{reply}")
+        if args.pressure_calibrate:
+            glove.calibrate()
+        elif hand in pressure_profile:
+            glove.calibration = PressureCalibration.from_dict(pressure_profile[hand])
+
+    if two_hands:
+        # 每隻手讀自己的手套
+        pressure_fn = lambda hand, index: get_finger_pressure(index, hand)
+        sample_times_fn = get_sample_times
+        calibration_fn = get_calibration
+    else:
+        # 只有一隻手套：不管偵測到的是哪隻手都讀這隻手套
+        pressure_fn = lambda hand, index: get_finger_pressure(index, PRIMARY_HAND)
+        sample_times_fn = lambda hand: get_sample_times(PRIMARY_HAND)
+        calibration_fn = lambda hand: get_calibration(PRIMARY_HAND)
+    controller = NoteController(sound_manager, keymap.white_keys, keymap.black_keys, screen_height,
+                                pressure_fn=pressure_fn, sample_times_fn=sample_times_fn,
+                                note_lut=keymap.lut, key_margin=args.key_margin,
+                                calibration_fn=calibration_fn)
+
+    predictor = None
+    if args.predict_onset:
+        predictor = OnsetPredictor(controller)
+        for glove in gloves.values():
+            glove.listeners.append(predictor.on_sample)
+
+    gate = None
+    if args.power_save:
+        # 背景擷取讓閒置時一出現按壓就能拿手上最新的 frame 推論
+        gate = InferenceGate(any_pressed)
+        camera.start_grabbing()
+    hand_positions = {}
+
+    try:
+        while True:
+            with trace_events.span("capture"):
+                ret, frame = camera.read() if gate is None else gate.wait_frame(camera)
+            if not ret:
+                break
+            captured_at = time.perf_counter()
+            frame = cv2.flip(frame, 1)
+            current_time = time.time()
+
+            hand_landmarks = [] if estimator is not None else None
+            if gate is None or gate.should_infer():
+                hand_positions = detect_hands(frame, finger_indices=FINGER_INDICES,
+                                              landmarks_out=hand_landmarks)
+            # 略過推論的 frame 沿用上一次的手指位置（此時沒有手指按壓，不會發出新音）
+            inferred_at = time.perf_counter()
+
+            if hand_landmarks:
+                # 手掌遠近改變時，背景重建鍵盤；這裡不會等待
+                for landmarks in hand_landmarks:
+                    estimator.observe(landmarks)
+                keymaps.update(estimator.pixel_per_cm)
+
+            # 每個 frame 只取一次 keymap，整個 frame 都用同一組完整的鍵盤
+            if keymaps.current is not keymap:
+                keymap = keymaps.current
+                controller.white_keys, controller.black_keys = keymap.white_keys, keymap.black_keys
+                controller.note_lut = keymap.lut
+            controller.update(hand_positions, current_time,
+                              captured_at=captured_at, inferred_at=inferred_at)
+            tracer.poll()
+
+            if display is None:
+                continue
+
+            # === 疊加鍵盤圖層（只重畫狀態有變的琴鍵）===
+            keymap.overlay.update(controller.flash_keys)
+            keymap.overlay.blend(frame)
+
+            # 交給顯示 thread，偵測迴圈不等待 GUI
+            display.show(frame)
+            if display.quit_requested:
+                break
+    except KeyboardInterrupt:
+        pass
+
+    for hand, glove in gloves.items():
+        if glove.calibration is not None:
+            # 存下追蹤後的基準，下次啟動從這裡開始
+            pressure_profile[hand] = glove.calibration.to_dict()
+    if estimator is not None or pressure_profile:
+        # 重新讀取後只寫回這次執行更新的欄位，不會蓋掉校正流程另外存進 profile 的結果
+        profile = load_profile()
+        if pressure_profile:
+            profile["pressure_cn"] = pressure_profile
+        if estimator is not None:
+            # 記下最後的估計，下次啟動直接使用
+            profile["pixel_per_cm"] = keymap.pixel_per_cm
+            print(f"📏 鍵盤依手掌距離重建 {keymaps.rebuilds} 次，最後每公分 {keymap.pixel_per_cm:.2f} pixels")
+        save_profile(profile)
+    if predictor is not None:
+        predictor.report()
+    if gate is not None:
+        print(f"💤 {gate.frames} 個 frame 中推論了 {gate.inferred} 個")
+    camera.release()
+    if display is not None:
+        display.close()
     close_detector()
+    sound_manager.close()
+    if glove_server is not None:
+        for hand, stat in glove_server.stats().items():
+            print(f"🧤 {hand}：{stat['samples']} 筆壓力，{stat['bad_lines']} 行無法解析")
+        glove_server.close()
     print("🎶 Piano Glove 結束～喵 🎶")
 
 if __name__ == "__main__":
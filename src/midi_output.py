@@ -0,0 +1,114 @@
+# midi_output.py
+import time
+
+from alsa_midi import (SequencerClient, READ_PORT, PortType,
+                       NoteOnEvent, NoteOffEvent, KeyPressureEvent)
+
+from new_sound_manager import note_to_midi
+from latency_trace import tracer
+
+# 事件排程在 queue 上的提前量（秒），讓 softsynth 端能以 queue 時間戳對齊
+SCHEDULE_AHEAD = 0.0
+
+
+class _PressureVolumes(dict):
+    """
+    和 SoundManager.volumes 相同用法的 dict：main.py 每個 frame 寫入 volumes[note] = volume，
+    發聲中的音符就會轉成 polyphonic aftertouch 事件送出。
+    """
+
+    def __init__(self, output):
+        super().__init__()
+        self._output = output
+
+    def __setitem__(self, note, volume):
+        super().__setitem__(note, volume)
+        self._output._send_pressure(note, volume)
+
+
+class MidiOutput:
+    """
+    把音符與壓力送到 ALSA sequencer port，而不是在本機合成聲音。
+    介面與 SoundManager 相同（preload_notes / play_note / stop_note / volumes / close），
+    main.py 只需要換掉建立的物件。
+
+    其他程式可用 aconnect 訂閱這個 port；要交給網路上另一台機器合成時，
+    可在兩端跑 aseqnet 把 sequencer 事件轉送過去。
+    """
+
+    def __init__(self, client_name="Piano Glove", channel=0):
+        self.channel = channel
+        self.client = SequencerClient(client_name)
+        self.port = self.client.create_port(
+            "glove out", caps=READ_PORT,
+            type=PortType.MIDI_GENERIC | PortType.APPLICATION)
+        self.queue = self.client.create_queue()
+        self.queue.start()
+        self.client.drain_output()
+        self._queue_start = time.perf_counter()
+
+        self.volumes = _PressureVolumes(self)
+        self.sounding = set()
+        self._last_pressure = {}
+        print(f"🎛️ MIDI 輸出 port：{self.client.client_id}:{self.port.port_id}")
+
+    @staticmethod
+    def _to_midi_value(volume):
+        return max(1, min(127, int(round(volume * 127))))
+
+    def _queue_time(self):
+        return time.perf_counter() - self._queue_start + SCHEDULE_AHEAD
+
+    def _emit(self, event):
+        self.client.event_output(event, queue=self.queue, port=self.port)
+        self.client.drain_output()
+
+    def _send_pressure(self, note, volume):
+        if note not in self.sounding or volume <= 0.0:
+            return
+        value = self._to_midi_value(volume)
+        if self._last_pressure.get(note) == value:
+            return  # 數值沒變就不重送，避免塞爆 sequencer
+        self._last_pressure[note] = value
+        self._emit(KeyPressureEvent(note=note_to_midi(note), velocity=value,
+                                    channel=self.channel, time=self._queue_time()))
+
+    def preload_notes(self, notes):
+        for note in notes:
+            dict.__setitem__(self.volumes, note, 0.0)
+        print(f"✅ MIDI 模式：{len(notes)} 個音符可用")
+
+    def play_note(self, note_name, volume=1.0, trace_id=None, aftertouch=None):
+        """aftertouch 不使用：MIDI 的壓力仍由每個 frame 寫入 volumes 轉成 KeyPressureEvent"""
+        if note_name not in self.volumes or note_name in self.sounding:
+            return
+        self.sounding.add(note_name)
+        self._last_pressure[note_name] = self._to_midi_value(volume)
+        dict.__setitem__(self.volumes, note_name, volume)
+        self._emit(NoteOnEvent(note=note_to_midi(note_name), velocity=self._to_midi_value(volume),
+                               channel=self.channel, time=self._queue_time()))
+        tracer.mark(trace_id, "audio_out")  # MIDI 模式以事件送出時間為準
+
+    def prearm(self, note_name):
+        """MIDI 事件無法預先備妥，由接收端自行處理"""
+        return False
+
+    def cancel_prearm(self, note_name):
+        pass
+
+    def stop_note(self, note_name):
+        if note_name not in self.sounding:
+            return
+        self.sounding.discard(note_name)
+        self._last_pressure.pop(note_name, None)
+        dict.__setitem__(self.volumes, note_name, 0.0)
+        self._emit(NoteOffEvent(note=note_to_midi(note_name), velocity=0,
+                                channel=self.channel, time=self._queue_time()))
+
+    def close(self):
+        for note in list(self.sounding):
+            self.stop_note(note)
+        self.queue.stop()
+        self.client.drain_output()
+        self.client.close()
+        print("🎛️ MIDI 輸出已關閉")
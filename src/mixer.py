@@ -0,0 +1,163 @@
+# mixer.py
+import threading
+import time
+
+import numpy as np
+
+DEFAULT_MAX_VOICES = 10
+STEAL_POLICIES = ("oldest", "quietest")
+
+
+class Voice:
+    """
+    一個正在發聲的音符；source(voice, frames) 負責產生 float32 chunk 並推進 voice.pos。
+    armed 的 voice 已經配置好但還沒開始發聲（預測到的按鍵），mix 時略過。
+    aftertouch() 有設定時，每個 block 由它取得最新的 gain（按著的手指壓力），
+    rendered_gain 是上一個 block 結束時實際用到的 gain，mix 由它內插到新的 gain。
+    """
+
+    __slots__ = ("key", "source", "gain", "pan", "pos", "started", "level", "trace_id", "armed",
+                 "aftertouch", "rendered_gain")
+
+    def __init__(self, key, source, gain, pan, armed=False):
+        self.key = key
+        self.source = source
+        self.gain = gain
+        self.pan = pan      # -1.0（左）~ 1.0（右）
+        self.pos = 0
+        self.started = time.perf_counter()
+        self.level = gain   # 最近一個 block 的輸出峰值，quietest 策略用
+        self.trace_id = None  # 延遲追蹤事件 id，第一次被 render 時標記 audio_out
+        self.armed = armed
+        self.aftertouch = None
+        self.rendered_gain = gain
+
+
+class VoiceMixer:
+    """
+    把所有 voice 混成一個輸出 block。
+    各 voice 的 chunk 疊成 (voices, frames) 矩陣，再乘上 (channels, voices) 的 gain/pan 矩陣，
+    加總、音量與左右聲道在同一次矩陣乘法完成（由 numpy / BLAS 做向量化）。
+    voice 數量上限為 max_voices，超過時依 steal 策略搶走最舊或最小聲的 voice，
+    因此每個 callback 的最壞耗時有上限。
+    armed 的 voice 不發聲、不算在上限內，也絕不搶走發聲中的 voice：發聲中的 voice 已滿時直接不備妥，
+    真正打開（fire）時才依 steal 策略騰出位置。
+    gain 在兩個 block 之間有變化時（aftertouch），在 block 內逐 sample 線性內插，不會有階梯雜音。
+    """
+
+    def __init__(self, channels=2, max_voices=DEFAULT_MAX_VOICES, steal="oldest"):
+        if steal not in STEAL_POLICIES:
+            raise ValueError(f"steal 策略必須是 {STEAL_POLICIES} 之一")
+        self.channels = channels
+        self.max_voices = max_voices
+        self.steal = steal
+        self.voices = {}
+        self.stolen = 0
+        self._fading = []   # 被搶走的 voice，下一個 block 淡出後移除
+        self._lock = threading.Lock()
+        self._ramp = np.zeros(0, dtype=np.float32)
+
+    def _pick_victim(self, sounding):
+        if self.steal == "quietest":
+            return min(sounding, key=lambda v: v.level)
+        return min(sounding, key=lambda v: v.started)
+
+    def _make_room(self):
+        """發聲中的 voice 已達上限時搶走一個（呼叫端持有 _lock）"""
+        sounding = [v for v in self.voices.values() if not v.armed]
+        if len(sounding) >= self.max_voices:
+            victim = self._pick_victim(sounding)
+            del self.voices[victim.key]
+            self._fading.append(victim)
+            self.stolen += 1
+
+    def note_on(self, key, source, gain=1.0, pan=0.0, armed=False):
+        """armed=True 時只在還有空位才備妥 voice，已滿時回傳 None（不搶佔）"""
+        with self._lock:
+            voice = self.voices.get(key)
+            if voice is not None:
+                voice.gain = gain
+                if voice.armed and not armed:
+                    self._make_room()
+                    voice.armed = False
+                return voice
+            if armed:
+                if sum(not v.armed for v in self.voices.values()) >= self.max_voices:
+                    return None
+            else:
+                self._make_room()
+            voice = Voice(key, source, gain, pan, armed)
+            self.voices[key] = voice
+            return voice
+
+    def fire(self, key, gain):
+        """打開 armed 的 voice：下一個 block 就以 gain 發聲（不從 0 內插上來）"""
+        with self._lock:
+            voice = self.voices.get(key)
+            if voice is None or not voice.armed:
+                return voice
+            self._make_room()
+            voice.gain = gain
+            voice.rendered_gain = gain
+            voice.armed = False
+            return voice
+
+    def note_off(self, key):
+        with self._lock:
+            self.voices.pop(key, None)
+
+    def set_gain(self, key, gain):
+        voice = self.voices.get(key)
+        if voice is not None:
+            voice.gain = gain
+
+    def _gain_matrix(self, voices, gains):
+        if self.channels == 1:
+            return gains.reshape(1, -1)
+        # 等功率 pan law
+        angle = (np.array([v.pan for v in voices], dtype=np.float32) + 1.0) * (np.pi / 4)
+        matrix = np.zeros((self.channels, len(voices)), dtype=np.float32)
+        matrix[0] = gains * np.cos(angle)
+        matrix[1] = gains * np.sin(angle)
+        return matrix
+
+    def _interpolation_ramp(self, frames):
+        """1/frames, 2/frames, ..., 1：block 最後一個 sample 剛好到達新的 gain"""
+        if len(self._ramp) != frames:
+            self._ramp = np.arange(1, frames + 1, dtype=np.float32) / frames
+        return self._ramp
+
+    def mix(self, outdata, frames):
+        with self._lock:
+            voices = [v for v in self.voices.values() if not v.armed]
+            fading, self._fading = self._fading, []
+
+        if not voices and not fading:
+            outdata.fill(0.0)
+            return
+
+        chunks = np.empty((len(voices) + len(fading), frames), dtype=np.float32)
+        for i, voice in enumerate(voices):
+            chunks[i] = voice.source(voice, frames)
+        if fading:
+            ramp = np.linspace(1.0, 0.0, frames, dtype=np.float32)
+            for i, voice in enumerate(fading, start=len(voices)):
+                chunks[i] = voice.source(voice, frames) * ramp
+
+        if self.steal == "quietest":
+            peaks = np.abs(chunks[:len(voices)]).max(axis=1)
+            for voice, peak in zip(voices, peaks):
+                voice.level = peak * voice.gain
+
+        voices += fading
+        gains = np.array([v.gain for v in voices], dtype=np.float32)
+        previous = np.array([v.rendered_gain for v in voices], dtype=np.float32)
+        if np.array_equal(gains, previous):
+            matrix = self._gain_matrix(voices, gains)
+        else:
+            chunks *= previous[:, None] + (gains - previous)[:, None] * self._interpolation_ramp(frames)
+            matrix = self._gain_matrix(voices, np.ones_like(gains))
+        for voice, gain in zip(voices, gains):
+            voice.rendered_gain = gain
+
+        outdata[:] = (matrix @ chunks).T
@@ -1,9 +1,16 @@
 import cv2
 import numpy as np
 
+from trace_events import traced
+
+WHITE_KEY_CM = 2.4
+BLACK_KEY_CM = 2.0
+BLACK_KEY_HEIGHT = 0.6  # 黑鍵佔鍵盤高度的比例
+DEFAULT_KEY_MARGIN = 8  # 手指要離開目前的琴鍵超過幾個 pixel 才換鍵
+
 def generate_keyboard_mapping(screen_width, pixel_per_cm):
-    white_key_width = pixel_per_cm * 2.4
-    black_key_width = pixel_per_cm * 2.0
+    white_key_width = pixel_per_cm * WHITE_KEY_CM
+    black_key_width = pixel_per_cm * BLACK_KEY_CM
 
     note_sequence = ['A', 'A#', 'B', 'C', 'C#', 'D', 'D#', 'E',
                      'F', 'F#', 'G', 'G#']
@@ -66,11 +73,71 @@ def generate_keyboard_mapping(screen_width, pixel_per_cm):
     return white_keys, black_keys, selected_notes[0], selected_notes[-1]
 
 
+@traced()
 def find_note_by_position(x, y, white_keys, black_keys, screen_height):
     for key in black_keys:  # 黑鍵優先判斷
-        if key["left"] <= x < key["right"] and y < int(screen_height * 0.6):
+        if key["left"] <= x < key["right"] and y < int(screen_height * BLACK_KEY_HEIGHT):
             return key["note"]
     for key in white_keys:
         if key["left"] <= x < key["right"]:
             return key["note"]
     return None
+
+
+class NoteLUT:
+    """
+    每個 pixel 對應哪個音符的查表。
+    琴鍵先畫在鍵盤平面（俯視、琴鍵為直條）上，有 homography（影像 → 鍵盤平面）時
+    再整張投影回攝影機影像，所以鏡頭斜拍時琴鍵是梯形，但查詢仍然只是一次陣列索引。
+    """
+
+    def __init__(self, white_keys, black_keys, screen_width, screen_height, homography=None):
+        self.notes = [key["note"] for key in white_keys + black_keys]
+        self.width = screen_width
+        self.height = screen_height
+
+        plane = np.full((screen_height, screen_width), -1, dtype=np.int16)
+        for i, key in enumerate(white_keys):
+            plane[:, max(0, key["left"]):max(0, key["right"])] = i
+        black_bottom = int(screen_height * BLACK_KEY_HEIGHT)
+        for i, key in enumerate(black_keys, start=len(white_keys)):
+            plane[:black_bottom, max(0, key["left"]):max(0, key["right"])] = i
+
+        if homography is None:
+            self.table = plane
+        else:
+            # WARP_INVERSE_MAP：homography 本身就是「輸出影像 → 鍵盤平面」的對應
+            self.table = cv2.warpPerspective(
+                plane, np.asarray(homography, dtype=np.float64), (screen_width, screen_height),
+                flags=cv2.INTER_NEAREST | cv2.WARP_INVERSE_MAP,
+                borderMode=cv2.BORDER_CONSTANT, borderValue=-1)
+
+    def note_at(self, x, y):
+        if 0 <= x < self.width and 0 <= y < self.height:
+            index = self.table[y, x]
+            if index >= 0:
+                return self.notes[index]
+        return None
+
+
+class StickyKeyMapper:
+    """
+    每根手指的琴鍵遲滯：手指停在兩個鍵的交界附近時，偵測抖動會讓它每個 frame 換一次鍵，
+    造成一連串 stop_note / play_note。這裡讓每根手指黏在目前的鍵上，
+    要離開原本的鍵超過 margin pixel（上下左右都算）才換成新的鍵。
+    """
+
+    def __init__(self, margin=DEFAULT_KEY_MARGIN):
+        self.margin = margin
+        self._current = {}  # finger → 目前的 note
+
+    def note_at(self, finger, x, y, lookup):
+        """lookup(x, y) 為原本的查詢（NoteLUT.note_at 或 find_note_by_position）"""
+        note = lookup(x, y)
+        current = self._current.get(finger)
+        if current is not None and note != current and self.margin > 0:
+            m = self.margin
+            if any(lookup(x + dx, y + dy) == current for dx, dy in ((-m, 0), (m, 0), (0, -m), (0, m))):
+                note = current
+        self._current[finger] = note
+        return note
@@ -1,15 +1,18 @@
 import numpy as np
-import sounddevice as sd
 import time
 import threading
 
+from audio_backend import open_backend, DEFAULT_PERIOD_SIZE, DEFAULT_PERIODS
+from mixer import VoiceMixer, DEFAULT_MAX_VOICES
+from latency_trace import tracer
+from trace_events import span
+
 SAMPLE_RATE = 44100
 NOTE_DURATION = 10
 note_names = ['C', 'C#', 'D', 'D#', 'E', 'F',
               'F#', 'G', 'G#', 'A', 'A#', 'B']
 
-def note_to_freq(note):
-    A4 = 440.0
+def note_to_midi(note):
     if len(note) == 3:
         key = note[:2]
         octave = int(note[2])
@@ -17,21 +20,42 @@ def note_to_freq(note):
         key = note[0]
         octave = int(note[1])
     n = note_names.index(key)
-    midi_num = (octave + 1) * 12 + n
+    return (octave + 1) * 12 + n
+
+def volume_to_velocity(volume):
+    """0~1 的音量 → MIDI velocity 1~127，用來選 sample 的力道分層"""
+    return max(1, min(127, int(round(volume * 127))))
+
+def note_to_freq(note):
+    A4 = 440.0
+    midi_num = note_to_midi(note)
     return A4 * 2 ** ((midi_num - 69) / 12)
 
 class SoundManager:
-    def __init__(self):
+    def __init__(self, backend="portaudio", period_size=DEFAULT_PERIOD_SIZE, periods=DEFAULT_PERIODS,
+                 instrument=None, channels=2, max_voices=DEFAULT_MAX_VOICES, steal="oldest",
+                 clock=time.time, monitor=True):
+        self.clock = clock  # 離線 render 時換成虛擬時鐘
+        self.instrument = instrument  # SampledInstrument；None 時使用正弦波
+        self.zones = {}  # note → 該音所有 velocity 分層（SampledInstrument.layers_for）
         self.waveforms = {}
-        self.streams = {}
         self.volumes = {}
-        self.positions = {}
         self.play_start_time = {}
         self.delayed_stops = {}
+        self.mixer = VoiceMixer(channels=channels, max_voices=max_voices, steal=steal)
+
+        # 所有音符共用同一個輸出 stream，由 _render 混音
+        if isinstance(backend, str):
+            backend = open_backend(backend, sample_rate=SAMPLE_RATE, channels=channels,
+                                   period_size=period_size, periods=periods)
+        self.backend = backend
+        self.backend.start(self._render)
 
-        # 啟動背景監控執行緒
-        self._monitor_thread = threading.Thread(target=self._background_monitor, daemon=True)
-        self._monitor_thread.start()
+        # 啟動背景監控執行緒（離線 render 由呼叫端自行呼叫 _check_and_stop_expired_notes）
+        if monitor:
+            self._monitor_thread = threading.Thread(target=self._background_monitor, daemon=True,
+                                                    name="note_monitor")
+            self._monitor_thread.start()
 
     def generate_waveform(self, freq):
         t = np.linspace(0, NOTE_DURATION, int(SAMPLE_RATE * NOTE_DURATION), False)
@@ -40,45 +64,118 @@ class SoundManager:
 
     def preload_notes(self, notes):
         for note in notes:
-            freq = note_to_freq(note)
-            if freq not in self.waveforms:
-                self.waveforms[freq] = self.generate_waveform(freq)
-            if note not in self.streams:
-                wf = self.waveforms[freq]
+            if self.instrument is not None:
+                self.zones[note] = self.instrument.layers_for(note)
+            else:
+                freq = note_to_freq(note)
+                if freq not in self.waveforms:
+                    self.waveforms[freq] = self.generate_waveform(freq)
+            if note not in self.volumes:
                 self.volumes[note] = 0.0
-                self.positions[note] = 0
-
-                def make_callback(note_id):
-                    def callback(outdata, frames, time_info, status):
-                        wf = self.waveforms[note_to_freq(note_id)]
-                        pos = self.positions[note_id]
-                        total_len = len(wf)
-
-                        if pos + frames <= total_len:
-                            chunk = wf[pos:pos+frames]
-                        else:
-                            part1 = wf[pos:]
-                            part2 = wf[:(frames - (total_len - pos))]
-                            chunk = np.concatenate((part1, part2))
-
-                        self.positions[note_id] = (pos + frames) % total_len
-                        outdata[:] = (self.volumes[note_id] * chunk.reshape(-1, 1))
-                    return callback
-
-                stream = sd.OutputStream(callback=make_callback(note), samplerate=SAMPLE_RATE, channels=1)
-                stream.start()
-                self.streams[note] = stream
-        print(f"✅ 預先啟動 {len(notes)} 個音符的 stream")
-
-    def play_note(self, note_name, volume=1.0):
+        print(f"✅ 預先載入 {len(notes)} 個音符的 waveform")
+
+    def _sine_source(self, voice, frames):
+        wf = self.waveforms[note_to_freq(voice.key)]
+        pos = voice.pos
+        total_len = len(wf)
+        voice.pos = (pos + frames) % total_len
+        if pos + frames <= total_len:
+            return wf[pos:pos+frames]
+        part1 = wf[pos:]
+        part2 = wf[:(frames - (total_len - pos))]
+        return np.concatenate((part1, part2))
+
+    def _sample_source(self, note_name, volume):
+        """依按下時的音量選 velocity 分層，回傳這個 voice 的 source"""
+        zone, step = self.instrument.pick_layer(self.zones[note_name], volume_to_velocity(volume))
+        render = self.instrument.render
+
+        def source(voice, frames):
+            chunk, voice.pos = render(zone, step, voice.pos, frames)
+            return chunk
+        return source
+
+    def _render(self, outdata, frames):
+        """音訊 callback：同步各 voice 的音量後交給 mixer 混音"""
+        with span("audio_render"):
+            self._render_block(outdata, frames)
+
+    def _render_block(self, outdata, frames):
+        for note_id, voice in list(self.mixer.voices.items()):
+            if voice.armed:
+                continue  # 預先備妥、尚未發聲
+            volume = self.volumes.get(note_id, 0.0)
+            if volume <= 0.0:
+                self.mixer.note_off(note_id)
+            elif voice.aftertouch is not None:
+                # 每個 block 讀一次手指最新的壓力（手套 1 kHz），不必等下一個 camera frame
+                voice.gain = max(0.0, min(1.0, voice.aftertouch()))
+            else:
+                voice.gain = volume
+            if voice.trace_id is not None:
+                # 這個 block 是 voice 的第一段輸出，實際出聲時間再加上輸出延遲
+                latency = self.backend.stats.output_latency or 0.0
+                tracer.mark(voice.trace_id, "audio_out", time.perf_counter() + latency)
+                voice.trace_id = None
+        self.mixer.mix(outdata, frames)
+
+    def close(self):
+        self.backend.stop()
+        stats = self.backend.stats.snapshot()
+        latency = stats["output_latency_ms"]
+        latency_text = "未知" if latency is None else f"{latency:.1f} ms"
+        if latency is not None and stats["output_latency_estimated"]:
+            latency_text += "（以主機時鐘估計）"
+        print(f"🔊 音訊統計 ({self.backend.name})：xrun {stats['xruns']} 次，"
+              f"callback 平均 {stats['callback_avg_ms']:.3f} ms / 最長 {stats['callback_max_ms']:.3f} ms，"
+              f"輸出延遲 {latency_text}，搶佔 voice {self.mixer.stolen} 次")
+
+    def play_note(self, note_name, volume=1.0, trace_id=None, aftertouch=None):
+        """aftertouch() 回傳按著這個音的手指目前的音量，發聲期間 callback 每個 block 讀一次"""
         if note_name in self.volumes:
             self.volumes[note_name] = volume
             if note_name not in self.play_start_time:
-                self.play_start_time[note_name] = time.time()
+                self.play_start_time[note_name] = self.clock()
+            voice = self.mixer.voices.get(note_name)
+            if voice is None:
+                voice = self._new_voice(note_name, volume)
+                voice.trace_id = trace_id
+            elif voice.armed:
+                # 已預先備妥：只要打開 voice，下一個 block 就出聲
+                self.mixer.fire(note_name, volume)
+                voice.trace_id = trace_id
+                if self.instrument is not None:
+                    # 備妥時還不知道力道，打開時才選分層（voice 尚未 render 過，pos 仍為 0）
+                    voice.source = self._sample_source(note_name, volume)
+            voice.aftertouch = aftertouch
+
+    def _new_voice(self, note_name, volume, armed=False):
+        if self.instrument is not None:
+            source = self._sample_source(note_name, volume)
+        else:
+            source = self._sine_source
+        # 依音高左右擺位：低音偏左、高音偏右
+        pan = float(np.clip(np.log2(note_to_freq(note_name) / 261.63) / 4, -0.5, 0.5))
+        return self.mixer.note_on(note_name, source, gain=volume, pan=pan, armed=armed)
+
+    def prearm(self, note_name):
+        """
+        預測即將按下：先配置好 voice（不發聲），真正按下時 play_note 直接打開它。
+        發聲中的 voice 已滿時不備妥（不為了預測搶走正在響的音），回傳 False。
+        """
+        if note_name not in self.volumes or note_name in self.mixer.voices:
+            return False
+        return self._new_voice(note_name, 0.0, armed=True) is not None
+
+    def cancel_prearm(self, note_name):
+        """預測落空：移除還沒發聲的 voice"""
+        voice = self.mixer.voices.get(note_name)
+        if voice is not None and voice.armed:
+            self.mixer.note_off(note_name)
 
     def stop_note(self, note_name):
         if note_name in self.volumes:
-            now = time.time()
+            now = self.clock()
             started = self.play_start_time.get(note_name, 0)
             min_duration = 0.2
             if now - started >= min_duration:
@@ -89,7 +186,7 @@ class SoundManager:
                 self.delayed_stops[note_name] = started + min_duration
 
     def _check_and_stop_expired_notes(self):
-        now = time.time()
+        now = self.clock()
         to_remove = []
         for note, stop_time in self.delayed_stops.items():
             if now >= stop_time:
@@ -0,0 +1,135 @@
+# note_controller.py
+import threading
+import time
+
+from new_screen_mapper import find_note_by_position, StickyKeyMapper, DEFAULT_KEY_MARGIN
+from latency_trace import tracer
+from pressure_reader import PRESS_THRESHOLD, force_to_level
+
+FINGER_INDICES = [4, 8, 12, 16, 20]
+FINGER_MAP = {4: 0, 8: 1, 12: 2, 16: 3, 20: 4}  # landmark → 壓力感測器編號
+FLASH_DURATION = 0.3
+
+
+def pressure_to_volume(pressure):
+    return force_to_level(pressure)
+
+
+class NoteController:
+    """
+    每個 frame 的音符判斷：手指位置 + 壓力 → play_note / stop_note。
+    每隻手（"left" / "right"）的五根手指對應到自己那隻手套的五個壓力感測器。
+    壓力來源以函式 pressure_fn(hand, index) 注入，main.py 接實際手套，benchmark 則接錄好的壓力紀錄。
+    有 note_lut（NoteLUT）時以每 pixel 查表找音符，否則逐一比對琴鍵範圍；
+    兩者都經過 StickyKeyMapper，手指在琴鍵交界抖動時不會來回換鍵。
+    有 predictor（OnsetPredictor）時，音符也可能在壓力資料一到就由讀取 thread 開始，不必等下一個 frame。
+    開始的音符會綁定按下它的手指，之後的音量由音訊 callback 直接讀那根手指的壓力（aftertouch）。
+    calibration_fn(hand) 回傳該手套的 PressureCalibration 時，按下門檻與音量改用每根手指自己的量程。
+    """
+
+    def __init__(self, sound_manager, white_keys, black_keys, screen_height,
+                 pressure_fn, sample_times_fn=lambda hand: (None, None), note_lut=None,
+                 key_margin=DEFAULT_KEY_MARGIN, calibration_fn=lambda hand: None):
+        self.sound_manager = sound_manager
+        self.white_keys = white_keys
+        self.black_keys = black_keys
+        self.screen_height = screen_height
+        self.note_lut = note_lut
+        self.sticky_keys = StickyKeyMapper(key_margin)
+        self.pressure_fn = pressure_fn
+        self.sample_times_fn = sample_times_fn
+        self.calibration_fn = calibration_fn
+        self.predictor = None
+        self.flash_keys = {}      # note → (time, volume)
+        self.active_notes = set() # 當前正在播放的 note 集合
+        self.lock = threading.Lock()  # predictor 會從讀取 thread 開始音符
+
+    def _is_pressed(self, hand, index, pressure):
+        calibration = self.calibration_fn(hand)
+        if calibration is None:
+            return pressure > PRESS_THRESHOLD
+        return pressure > calibration.threshold(index)
+
+    def _volume(self, hand, index, pressure):
+        calibration = self.calibration_fn(hand)
+        if calibration is None:
+            return pressure_to_volume(pressure)
+        return calibration.normalize(index, pressure)
+
+    def _aftertouch(self, hand, index):
+        pressure_fn = self.pressure_fn
+        return lambda: self._volume(hand, index, pressure_fn(hand, index))
+
+    def _start_note(self, note, volume, hand, index, captured_at=None, inferred_at=None):
+        adc_at, received_at = self.sample_times_fn(hand)
+        trace_id = tracer.new_event(
+            note, adc=adc_at, serial_rx=received_at, capture=captured_at,
+            inference=inferred_at, decision=time.perf_counter())
+        self.sound_manager.play_note(note, volume=volume, trace_id=trace_id,
+                                     aftertouch=self._aftertouch(hand, index))
+        self.active_notes.add(note)
+
+    def start_from_sample(self, note, pressure, hand, index, current_time):
+        """由 predictor 在壓力越過門檻的那一筆資料到達時呼叫；已在播放時回傳 False"""
+        with self.lock:
+            if note in self.active_notes:
+                return False
+            volume = self._volume(hand, index, pressure)
+            self.sound_manager.volumes[note] = volume
+            self._start_note(note, volume, hand, index)
+            self.flash_keys[note] = (current_time, volume)
+            return True
+
+    def update(self, hands, current_time, captured_at=None, inferred_at=None):
+        """處理一個 frame 的手指位置（hand → FINGER_INDICES 順序的座標），回傳這個 frame 新按下的音符"""
+        with self.lock:
+            return self._update(hands, current_time, captured_at, inferred_at)
+
+    def _lookup(self, x, y):
+        if self.note_lut is not None:
+            return self.note_lut.note_at(x, y)
+        return find_note_by_position(x, y, self.white_keys, self.black_keys, self.screen_height)
+
+    def _update(self, hands, current_time, captured_at, inferred_at):
+        sound_manager = self.sound_manager
+        active_notes = self.active_notes
+        started = []
+        current_notes = set()
+
+        for hand, finger_positions in hands.items():
+            for landmark_index, (x, y) in zip(FINGER_INDICES, finger_positions):
+                note = self.sticky_keys.note_at((hand, landmark_index), x, y, self._lookup)
+                pressure_index = FINGER_MAP.get(landmark_index)
+                if self.predictor is not None:
+                    self.predictor.observe(hand, pressure_index, note, y, captured_at)
+
+                if note and pressure_index is not None:
+                    current_notes.add(note)
+                    pressure = self.pressure_fn(hand, pressure_index)
+                    volume = self._volume(hand, pressure_index, pressure)
+
+                    if self._is_pressed(hand, pressure_index, pressure):
+                        sound_manager.volumes[note] = volume
+
+                        if note not in active_notes:
+                            self._start_note(note, volume, hand, pressure_index, captured_at, inferred_at)
+                            started.append(note)
+                        self.flash_keys[note] = (current_time, volume)
+                    else:
+                        if note in active_notes:
+                            sound_manager.stop_note(note)
+                            active_notes.remove(note)
+
+        # 偵測離開畫面或未按壓者，停止播放
+        for note in list(active_notes):
+            if note not in current_notes:
+                sound_manager.stop_note(note)
+                active_notes.remove(note)
+
+        # 清除過期的閃燈
+        for note in list(self.flash_keys.keys()):
+            timestamp, _ = self.flash_keys[note]
+            if current_time - timestamp >= FLASH_DURATION:
+                del self.flash_keys[note]
+
+        return started
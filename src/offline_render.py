@@ -0,0 +1,121 @@
+# offline_render.py
+import argparse
+import csv
+import time
+import wave
+
+import numpy as np
+
+from audio_backend import NullBackend, DEFAULT_PERIOD_SIZE
+from mixer import DEFAULT_MAX_VOICES
+from new_sound_manager import SoundManager, SAMPLE_RATE
+
+# 最後一個事件之後再多 render 的秒數（讓 release 完整收尾）
+TAIL_SECONDS = 0.5
+
+
+def load_events(path):
+    """
+    讀取事件檔（CSV，欄位：time, note, volume）。
+    volume > 0 代表按下或更新壓力，volume = 0 代表放開，語意與 main.py 呼叫 SoundManager 的方式相同。
+    """
+    events = []
+    with open(path, newline="") as f:
+        for row in csv.DictReader(f):
+            events.append((float(row["time"]), row["note"], float(row["volume"])))
+    events.sort(key=lambda e: e[0])
+    return events
+
+
+def write_wav(path, audio, sample_rate=SAMPLE_RATE):
+    """把 float32 (frames, channels) 寫成 16-bit PCM WAV"""
+    pcm = (np.clip(audio, -1.0, 1.0) * 32767).astype("<i2")
+    with wave.open(path, "wb") as f:
+        f.setnchannels(audio.shape[1])
+        f.setsampwidth(2)
+        f.setframerate(sample_rate)
+        f.writeframes(pcm.tobytes())
+
+
+def render_offline(events, out_path=None, instrument=None, period_size=DEFAULT_PERIOD_SIZE,
+                   max_voices=DEFAULT_MAX_VOICES, steal="oldest", channels=2):
+    """
+    以 NullBackend 盡快拉資料，用虛擬時鐘驅動 SoundManager，走和即時播放完全相同的合成與混音路徑。
+    回傳統計 dict；有指定 out_path 時同時寫出 WAV。
+    """
+    clock = [0.0]
+    backend = NullBackend(paced=False, sample_rate=SAMPLE_RATE, channels=channels,
+                          period_size=period_size)
+    manager = SoundManager(backend=backend, instrument=instrument, channels=channels,
+                           max_voices=max_voices, steal=steal,
+                           clock=lambda: clock[0], monitor=False)
+    manager.preload_notes(sorted({note for _, note, _ in events}))
+
+    end_time = (events[-1][0] if events else 0.0) + TAIL_SECONDS
+    total_blocks = int(np.ceil(end_time * SAMPLE_RATE / period_size))
+    audio = np.empty((total_blocks * period_size, channels), dtype=np.float32)
+    block_seconds = period_size / SAMPLE_RATE
+
+    next_event = 0
+    voice_seconds = 0.0
+    sounding = set()
+    cpu_start = time.process_time()
+    wall_start = time.perf_counter()
+    for block in range(total_blocks):
+        clock[0] = block * block_seconds
+        while next_event < len(events) and events[next_event][0] <= clock[0]:
+            _, note, volume = events[next_event]
+            if volume > 0.0:
+                manager.volumes[note] = volume
+                if note not in sounding:
+                    manager.play_note(note, volume=volume)
+                    sounding.add(note)
+            elif note in sounding:
+                manager.stop_note(note)
+                sounding.discard(note)
+            next_event += 1
+        manager._check_and_stop_expired_notes()
+        voice_seconds += len(manager.mixer.voices) * block_seconds
+        audio[block * period_size:(block + 1) * period_size] = backend.pull(period_size)
+    cpu_seconds = time.process_time() - cpu_start
+    wall_seconds = time.perf_counter() - wall_start
+
+    if out_path is not None:
+        write_wav(out_path, audio)
+
+    return {
+        "audio_seconds": total_blocks * block_seconds,
+        "cpu_seconds": cpu_seconds,
+        "wall_seconds": wall_seconds,
+        "voice_seconds": voice_seconds,
+        "voice_seconds_per_cpu_second": voice_seconds / cpu_seconds if cpu_seconds else float("inf"),
+        "realtime_factor": total_blocks * block_seconds / wall_seconds if wall_seconds else float("inf"),
+        "stolen_voices": manager.mixer.stolen,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description="離線 render 音符事件成 WAV（不需要音效裝置）")
+    parser.add_argument("events", help="事件 CSV（time, note, volume）")
+    parser.add_argument("output", nargs="?", default=None, help="輸出 WAV 路徑；省略則只做 benchmark")
+    parser.add_argument("--samples", default=None, help="取樣音色來源（同 main.py）")
+    parser.add_argument("--period-size", type=int, default=DEFAULT_PERIOD_SIZE)
+    parser.add_argument("--max-voices", type=int, default=DEFAULT_MAX_VOICES)
+    parser.add_argument("--steal", default="oldest", choices=["oldest", "quietest"])
+    args = parser.parse_args()
+
+    instrument = None
+    if args.samples:
+        from sampled_instrument import SampledInstrument
+        instrument = SampledInstrument(args.samples)
+
+    stats = render_offline(load_events(args.events), args.output, instrument=instrument,
+                           period_size=args.period_size, max_voices=args.max_voices, steal=args.steal)
+    print(f"🎼 render {stats['audio_seconds']:.2f} 秒音訊，CPU {stats['cpu_seconds']:.3f} 秒"
+          f"（{stats['realtime_factor']:.1f}x 即時）")
+    print(f"📈 合成吞吐量：{stats['voice_seconds_per_cpu_second']:.1f} voice·秒 / CPU 秒，"
+          f"搶佔 voice {stats['stolen_voices']} 次")
+
+
+if __name__ == "__main__":
+    main()
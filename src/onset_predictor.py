@@ -0,0 +1,151 @@
+# onset_predictor.py
+import itertools
+import threading
+import time
+
+from pressure_reader import PRESS_THRESHOLD, PRESSURE_FULL_SCALE_CN
+
+LOOKAHEAD = 0.015          # 預估 15 ms 內會越過門檻就先備妥 voice
+ARM_TIMEOUT = 0.06         # 備妥後這麼久都沒越過門檻就取消
+SLOPE_SAMPLES = 4          # 用最近幾筆壓力估斜率
+MIN_DOWN_VELOCITY = 40.0   # 指尖向下速度（pixel/s）至少這麼快才算在按鍵
+STRONG_SLOPE = 20.0 * PRESSURE_FULL_SCALE_CN  # 壓力上升夠快（cN/s，50 ms 內達滿刻度）時，即使沒有影像速度也預測
+VELOCITY_SMOOTHING = 0.5   # 指尖速度的指數平滑係數
+STALE_FINGER = 0.2         # 手指超過這麼久沒出現在影像中就不再預測
+
+
+class _Finger:
+    __slots__ = ("note", "y", "seen_at", "velocity", "armed_note", "armed_at", "pressed")
+
+    def __init__(self):
+        self.note = None
+        self.y = None
+        self.seen_at = None
+        self.velocity = None     # 指尖在影像中的向下速度（pixel/s）
+        self.armed_note = None
+        self.armed_at = None
+        self.pressed = False
+
+
+class OnsetPredictor:
+    """
+    結合高頻率的壓力斜率與影像中的指尖向下速度，在壓力真正越過門檻前幾毫秒預測按鍵：
+    先在 mixer 裡備妥（不發聲的）voice，等越過門檻的那一筆壓力到達時直接在讀取 thread 上打開它，
+    不必等到下一個 camera frame；預測落空則取消。
+    """
+
+    def __init__(self, controller, threshold=PRESS_THRESHOLD, lookahead=LOOKAHEAD,
+                 clock=time.perf_counter):
+        self.controller = controller
+        self.sound_manager = controller.sound_manager
+        self.threshold = threshold
+        self.lookahead = lookahead
+        self.clock = clock
+        self._fingers = {}  # (hand, 感測器編號) → _Finger
+        self._lock = threading.Lock()
+        controller.predictor = self
+
+        self.armed = 0
+        self.cancelled = 0
+        self.commits = 0
+        self.commits_armed = 0
+        self.lead_times = []  # 備妥到實際越過門檻的時間（秒）
+
+    def observe(self, hand, index, note, y, frame_time):
+        """由 NoteController 每個 frame 呼叫：更新手指目前所在的音符與向下速度"""
+        if index is None:
+            return
+        frame_time = frame_time or self.clock()
+        cancel = None
+        with self._lock:
+            finger = self._fingers.setdefault((hand, index), _Finger())
+            if finger.y is not None and frame_time > finger.seen_at:
+                velocity = (y - finger.y) / (frame_time - finger.seen_at)
+                if finger.velocity is None:
+                    finger.velocity = velocity
+                else:
+                    finger.velocity += VELOCITY_SMOOTHING * (velocity - finger.velocity)
+            finger.y = y
+            finger.seen_at = frame_time
+            finger.note = note
+            if finger.armed_note is not None and finger.armed_note != note:
+                cancel = finger.armed_note  # 手指移到別的鍵
+                finger.armed_note = None
+        if cancel is not None:
+            self._cancel(cancel)
+
+    def on_sample(self, stream):
+        """GloveStream listener：每筆壓力資料到達時在讀取 thread 上呼叫"""
+        now = self.clock()
+        # 只取最近 SLOPE_SAMPLES 筆（由新到舊取出後反轉回時間順序），不複製整個 history
+        history = list(itertools.islice(reversed(stream.history), SLOPE_SAMPLES))[::-1]
+        actions = []
+        with self._lock:
+            for index, pressure in enumerate(stream.value):
+                finger = self._fingers.get((stream.hand, index))
+                if finger is None:
+                    continue
+                if finger.seen_at is None or now - finger.seen_at > STALE_FINGER:
+                    finger.note = None
+
+                threshold = stream.threshold(index) if stream.calibration is not None else self.threshold
+                if pressure > threshold:
+                    if not finger.pressed and finger.note is not None:
+                        actions.append(("commit", finger, finger.note, index, pressure, finger.armed_at))
+                    finger.pressed = True
+                    finger.armed_note = None
+                    continue
+
+                finger.pressed = False
+                if finger.armed_note is not None:
+                    if now - finger.armed_at > ARM_TIMEOUT:
+                        actions.append(("cancel", finger, finger.armed_note, index, None, None))
+                        finger.armed_note = None
+                elif finger.note is not None and self._predict(finger, index, pressure, threshold, history):
+                    actions.append(("arm", finger, finger.note, index, None, now))
+
+        for action, finger, note, index, pressure, armed_at in actions:
+            if action == "arm":
+                # 只有 mixer 真的備妥 voice 才記下 armed_note，否則下一筆壓力還能再試
+                if self.sound_manager.prearm(note):
+                    with self._lock:
+                        stale = finger.note != note or finger.pressed
+                        if not stale:
+                            finger.armed_note = note
+                            finger.armed_at = armed_at
+                    if stale:
+                        self.sound_manager.cancel_prearm(note)
+                    else:
+                        self.armed += 1
+            elif action == "cancel":
+                self._cancel(note)
+            elif self.controller.start_from_sample(note, pressure, stream.hand, index, time.time()):
+                self.commits += 1
+                if armed_at is not None:
+                    self.commits_armed += 1
+                    self.lead_times.append(now - armed_at)
+
+    def _predict(self, finger, index, pressure, threshold, history):
+        if len(history) < 2:
+            return False
+        (t0, first), (t1, last) = history[0], history[-1]
+        if t1 <= t0:
+            return False
+        slope = (last[index] - first[index]) / (t1 - t0)
+        if slope <= 0:
+            return False
+        time_to_threshold = (threshold - pressure) / slope
+        if time_to_threshold > self.lookahead:
+            return False
+        # 影像與壓力一致：指尖正往下；或壓力上升快到不需要影像佐證
+        moving_down = finger.velocity is not None and finger.velocity >= MIN_DOWN_VELOCITY
+        return moving_down or slope >= STRONG_SLOPE
+
+    def _cancel(self, note):
+        self.sound_manager.cancel_prearm(note)
+        self.cancelled += 1
+
+    def report(self):
+        lead = sum(self.lead_times) / len(self.lead_times) * 1000 if self.lead_times else 0.0
+        print(f"🎯 onset 預測：{self.commits} 個音在壓力到達時立即開始（{self.commits_armed} 個已預先備妥，"
+              f"平均提前 {lead:.1f} ms），備妥 {self.armed} 次、取消 {self.cancelled} 次")
@@ -1,48 +1,347 @@
 # pressure_reader.py
+import collections
+import math
+import queue
 import serial
 import threading
 import time
 
+from trace_events import span
+
 # 串列埠參數
-SERIAL_PORT = 'COM4'
-BAUD_RATE = 9600
-
-# 壓力數值（共五指）
-value = [0, 0, 0, 0, 0]
-
-# 初始化序列連線
-try:
-    ser = serial.Serial(SERIAL_PORT, BAUD_RATE, timeout=1)
-    time.sleep(2)  # 給 Arduino 一點時間初始化
-except serial.SerialException:
-    print(f"❌ 無法開啟序列埠 {SERIAL_PORT}")
-    ser = None
-
-def read_serial_loop():
-    global value
-    if ser is None:
-        return
-    while True:
-        try:
-            line = ser.readline().decode('utf-8').strip()
+SERIAL_PORT = None  # None 時依 USB VID/PID 自動尋找手套
+BAUD_RATE = 115200      # 與韌體 glove_config.h 的 GLOVE_UART_BAUD 相同
+HANDSHAKE_TIMEOUT = 2.0
+COMMAND_TIMEOUT = 1.0   # 等韌體回覆指令的時間
+PRIMARY_HAND = "right"  # 只接一隻手套時，它就是這隻手
+HISTORY_SIZE = 256      # 每隻手套保留最近幾筆壓力
+CLOCK_OFFSET_WINDOW = 10.0  # 時鐘偏移取最近這麼多秒內的最小值（50 ppm 的晶振漂移在窗內只差 0.5 ms）
+CLOCK_JUMP_TOLERANCE = 1.0  # 裝置時間比主機多走超過這麼多秒，視為韌體重開而不是計數器溢位
+
+# 壓力單位為 cN：韌體預設（FMT FORCE）送出扣掉基準、線性化後的力，0 ~ 滿刻度
+PRESSURE_FULL_SCALE_CN = 2000              # 與韌體 glove/fsr_lut.h 的 FSR_LUT_MAX_CN 相同
+PRESS_THRESHOLD = PRESSURE_FULL_SCALE_CN // 40    # 50 cN：壓力超過這個值才算按下（高於韌體凍結基準的 15 cN）
+FULL_VOLUME_CN = PRESSURE_FULL_SCALE_CN // 2      # 沒有校正時，壓到 10 N 為最大音量
+
+# 每根手指自動量程（--pressure-calibrate 或 profile 中有校正資料時使用）
+NOISE_SIGMAS = 4.0         # 按下門檻 = 基準 + 4 倍雜訊
+MIN_ONSET_MARGIN = 15      # 門檻至少高於基準這麼多（cN）
+MIN_SPAN = PRESSURE_FULL_SCALE_CN // 20    # 最大值至少高於門檻這麼多（cN）
+DEFAULT_SPAN = FULL_VOLUME_CN              # 校正時某根手指沒有按到時假設的量程（cN）
+BASELINE_TIME_CONSTANT = 2.0  # 沒按壓時基準與雜訊追蹤目前數值的時間常數（秒），依實際取樣間隔換算，與取樣率無關
+
+# 手套上 PSoC6 KitProg3 USB-UART 的 (VID, PID)
+GLOVE_USB_IDS = [(0x04B4, 0xF155), (0x04B4, 0xF154), (0x04B4, 0xF166)]
+
+
+def discover_ports(usb_ids=GLOVE_USB_IDS):
+    """列出 USB VID/PID 符合手套的序列埠"""
+    from serial.tools import list_ports
+    return sorted(port.device for port in list_ports.comports() if (port.vid, port.pid) in usb_ids)
+
+
+class FingerRange:
+    """一根手指的感測器量程：放鬆時的基準、雜訊（平均絕對偏差）與按到底的最大值"""
+
+    __slots__ = ("baseline", "noise", "maximum")
+
+    def __init__(self, baseline, noise, maximum):
+        self.baseline = baseline
+        self.noise = noise
+        self.maximum = maximum
+
+    @property
+    def threshold(self):
+        return self.baseline + max(MIN_ONSET_MARGIN, NOISE_SIGMAS * self.noise)
+
+    def normalize(self, value):
+        """基準 → 0、最大值 → 1"""
+        span = max(self.maximum, self.threshold + MIN_SPAN) - self.baseline
+        return min(1.0, max(0.0, (value - self.baseline) / span))
+
+    def track(self, value, alpha):
+        """alpha：這一筆往目前數值靠近的比例"""
+        if value > self.maximum:
+            self.maximum = value
+        if value > self.threshold:
+            return  # 按壓中不更新基準
+        deviation = abs(value - self.baseline)
+        self.baseline += alpha * (value - self.baseline)
+        self.noise += alpha * (deviation - self.noise)
+
+
+class PressureCalibration:
+    """
+    一隻手套五根手指各自的量程。每個感測器的基準與量程都不同，而且會隨溫度與磨損漂移，
+    所以由校正手勢量出初始值後，讀取 thread 每收到一筆就在手指放鬆時慢慢追蹤基準。
+    """
+
+    def __init__(self, ranges):
+        self.ranges = ranges
+        self._last_time = None  # 上一筆追蹤的取樣時間
+
+    @classmethod
+    def from_samples(cls, rest, press):
+        """rest / press：放鬆與用力按壓期間收到的壓力（每筆五指）"""
+        ranges = []
+        for index in range(5):
+            idle = sorted(values[index] for values in rest)
+            baseline = idle[len(idle) // 2]
+            noise = max(1.0, sum(abs(v - baseline) for v in idle) / len(idle))
+            peak = max((values[index] for values in press), default=baseline)
+            finger = FingerRange(float(baseline), noise, float(peak))
+            if peak < finger.threshold + MIN_SPAN:
+                print(f"⚠️ 第 {index} 指沒有明顯按壓，量程先假設為 {DEFAULT_SPAN}")
+                finger.maximum = baseline + DEFAULT_SPAN
+            ranges.append(finger)
+        return cls(ranges)
+
+    @classmethod
+    def from_dict(cls, data):
+        return cls([FingerRange(f["baseline"], f["noise"], f["max"]) for f in data])
+
+    def to_dict(self):
+        return [{"baseline": round(f.baseline, 2), "noise": round(f.noise, 2), "max": f.maximum}
+                for f in self.ranges]
+
+    def threshold(self, index):
+        return self.ranges[index].threshold
+
+    def normalize(self, index, value):
+        return self.ranges[index].normalize(value)
+
+    def track(self, values, timestamp):
+        """timestamp：這一筆的取樣時間（秒）；追蹤比例由與上一筆的間隔算出，韌體改變取樣率也不受影響"""
+        last, self._last_time = self._last_time, timestamp
+        if last is None:
+            return
+        # 中斷後的第一筆最多只當作一個時間常數，不會讓基準一口氣跳到單一筆的數值
+        dt = min(max(0.0, timestamp - last), BASELINE_TIME_CONSTANT)
+        alpha = 1.0 - math.exp(-dt / BASELINE_TIME_CONSTANT)
+        for finger, value in zip(self.ranges, values):
+            finger.track(value, alpha)
+
+
+class GloveStream:
+    """
+    一隻手套的序列連線與最新的五指壓力。
+    每隻手套各自一條序列埠、一個讀取 thread，以及自己的裝置時鐘換算。
+    """
+
+    def __init__(self, hand, port, baud_rate=BAUD_RATE):
+        self.hand = hand
+        self.port = port
+        self.baud_rate = baud_rate
+        self.ser = None
+
+        # 壓力數值（共五指）
+        self.value = [0, 0, 0, 0, 0]
+
+        # 最新一筆資料的時間（time.perf_counter()）：(ADC 轉換時間, 收到時間)
+        # 韌體有送第 6 欄（微秒時間戳）時才有 ADC 轉換時間，否則為 None
+        self.sample_times = (None, None)
+
+        # 最近 HISTORY_SIZE 筆 (取樣時間, 壓力) 與統計；有 ADC 時間戳時用它，否則用收到時間
+        self.history = collections.deque(maxlen=HISTORY_SIZE)
+        self.samples = 0
+        self.bad_lines = 0
+        self.listeners = []  # 每收到一筆就呼叫 listener(stream)，在讀取 thread 上執行
+        self.calibration = None  # PressureCalibration；None 時使用固定的 PRESS_THRESHOLD
+
+        # 裝置時鐘 → 主機時鐘的偏移估計：最近 CLOCK_OFFSET_WINDOW 秒內最小的差值（傳輸延遲最小的那一筆），
+        # 用視窗而不是歷來最小值，才能跟上兩邊晶振的漂移
+        self._offsets = collections.deque()  # (收到時間, 偏移)，偏移遞增，第一筆即視窗內最小
+        self._last_device_us = None
+        self._last_received = None
+        self._device_wraps = 0
+        self._first_sample = threading.Event()
+        self._replies = queue.Queue()  # 韌體對指令的回覆（"#OK ..." / "#ERR ..." 行）
+
+    def _device_to_host_time(self, device_us, received):
+        """把韌體的 32-bit 微秒計數換算成主機 perf_counter 時間"""
+        if self._last_device_us is not None:
+            forward_us = (device_us - self._last_device_us) % 2**32
+            if forward_us > (received - self._last_received + CLOCK_JUMP_TOLERANCE) * 1e6:
+                # 計數器往回跳、且不是溢位（韌體重開從 0 開始數）：換算重新開始
+                self._device_wraps = 0
+                self._offsets.clear()
+            elif device_us < self._last_device_us:
+                self._device_wraps += 1  # 計數器約每 71 分鐘溢位一次
+        self._last_device_us = device_us
+        self._last_received = received
+        device_time = (device_us + self._device_wraps * 2**32) / 1e6
+
+        offset = received - device_time
+        offsets = self._offsets
+        while offsets and offsets[-1][1] >= offset:
+            offsets.pop()
+        offsets.append((received, offset))
+        while offsets[0][0] < received - CLOCK_OFFSET_WINDOW:
+            offsets.popleft()
+        return device_time + offsets[0][1]
+
+    def feed_line(self, line, received):
+        """解析一行韌體輸出（5 欄壓力，或再加 1 欄微秒時間戳；# 開頭的是指令回覆）"""
+        if line.startswith("#"):
+            self._replies.put(line[1:])
+            return
+        with span("serial_parse"):
             values = line.split(",")
-            if len(values) == 5:
-                value = [int(v) for v in values]
-        except:
-            pass  # 忽略錯誤避免中斷 thread
-
-def     get_finger_pressure(index):
-    """取得指定手指的壓力值，index = 0~4"""
-    if 0 <= index < 5:
-        return value[index]
-    else:
+            try:
+                if len(values) == 6:
+                    adc_time = self._device_to_host_time(int(values[5]), received)
+                    self.value = [int(v) for v in values[:5]]
+                    self.sample_times = (adc_time, received)
+                elif len(values) == 5:
+                    self.value = [int(v) for v in values]
+                    self.sample_times = (None, received)
+                else:
+                    self.bad_lines += 1
+                    return
+            except ValueError:
+                self.bad_lines += 1
+                return
+            self.samples += 1
+            self.history.append((self.sample_times[0] or received, self.value))
+            if self.calibration is not None:
+                self.calibration.track(self.value, self.history[-1][0])
+            self._first_sample.set()
+        for listener in self.listeners:
+            listener(self)
+
+    def wait_first_sample(self, timeout=HANDSHAKE_TIMEOUT):
+        """等第一筆完整資料（handshake）；逾時回傳 False"""
+        if self._first_sample.wait(timeout):
+            return True
+        print(f"⚠️ 序列埠 {self.port} 在 {timeout} 秒內沒有收到資料")
+        return False
+
+    def read_loop(self):
+        while True:
+            try:
+                line = self.ser.readline().decode('utf-8').strip()
+                self.feed_line(line, time.perf_counter())
+            except:
+                pass  # 忽略錯誤避免中斷 thread
+
+    def send_command(self, command, timeout=COMMAND_TIMEOUT):
+        """
+        送一行指令給手套韌體（例如 "RATE 200"、"AVG 4"，見 ADC_basic_1/glove/glove_command.h），
+        回傳韌體的回覆（"OK ..." 或 "ERR ..."）；逾時回傳 None
+        """
+        while not self._replies.empty():
+            self._replies.get_nowait()  # 丟掉之前沒人等的回覆
+        self.ser.write((command + "\n").encode("ascii"))
+        try:
+            reply = self._replies.get(timeout=timeout)
+        except queue.Empty:
+            print(f"⚠️ 手套 {self.hand} 沒有回覆指令 {command}")
+            return None
+        if reply.startswith("ERR"):
+            print(f"⚠️ 手套 {self.hand}：{reply}")
+        return reply
+
+    def threshold(self, index):
+        return self.calibration.threshold(index) if self.calibration is not None else PRESS_THRESHOLD
+
+    def calibrate(self, rest_seconds=2.0, press_seconds=4.0):
+        """校正手勢：先放鬆量基準與雜訊，再五指輪流按到底量最大值"""
+        samples = []
+        collect = lambda stream: samples.append(stream.value)
+        self.listeners.append(collect)
+        try:
+            print(f"🖐️ [{self.hand}] 手指放鬆、不要碰桌面（{rest_seconds:.0f} 秒）")
+            time.sleep(rest_seconds)
+            rest, samples[:] = list(samples), []
+            print(f"👇 [{self.hand}] 五根手指輪流用力按到底（{press_seconds:.0f} 秒）")
+            time.sleep(press_seconds)
+            press = list(samples)
+        finally:
+            self.listeners.remove(collect)
+        if not rest:
+            print(f"⚠️ 手套 {self.hand} 沒有收到資料，略過壓力校正")
+            return None
+        self.calibration = PressureCalibration.from_samples(rest, press)
+        print(f"✅ [{self.hand}] 按下門檻：" +
+              ", ".join(f"{self.calibration.threshold(i):.0f}" for i in range(5)))
+        return self.calibration
+
+    def open(self, timeout=HANDSHAKE_TIMEOUT):
+        """
+        開啟序列埠並啟動背景讀取 thread。
+        不再固定 sleep 2 秒，而是等到第一筆完整資料進來（最多 timeout 秒）就視為 handshake 完成。
+        """
+        try:
+            self.ser = serial.Serial(self.port, self.baud_rate, timeout=1)
+        except serial.SerialException:
+            print(f"❌ 無法開啟序列埠 {self.port}")
+            return False
+
+        # 啟動背景讀取 thread
+        thread = threading.Thread(target=self.read_loop, daemon=True, name=f"serial_reader_{self.hand}")
+        thread.start()
+        self.wait_first_sample(timeout)
+        return True
+
+
+# 已開啟的手套：hand（"left" / "right"）→ GloveStream
+gloves = {}
+
+
+def open_serial(port=SERIAL_PORT, baud_rate=BAUD_RATE, timeout=HANDSHAKE_TIMEOUT, hand=PRIMARY_HAND):
+    """開啟某隻手的手套（每隻手套一個讀取 thread）；同一隻手重複呼叫不會重開"""
+    if hand in gloves:
+        return True
+    if port is None:
+        in_use = {glove.port for glove in gloves.values()}
+        found = [p for p in discover_ports() if p not in in_use]
+        if not found:
+            print("❌ 找不到手套（沒有符合 USB VID/PID 的序列埠）")
+            return False
+        port = found[0]
+    glove = GloveStream(hand, port, baud_rate)
+    if not glove.open(timeout):
+        return False
+    gloves[hand] = glove
+    return True
+
+def     get_finger_pressure(index, hand=PRIMARY_HAND):
+    """取得指定手指的壓力值，index = 0~4；該手沒有手套時回傳 0"""
+    if not 0 <= index < 5:
         raise ValueError("Finger index must be between 0 and 4.")
+    glove = gloves.get(hand)
+    return glove.value[index] if glove is not None else 0
+
+def any_pressed():
+    """任何一隻手套的任何一根手指正在按壓（有校正時用每根手指自己的門檻）"""
+    for glove in list(gloves.values()):
+        values = glove.value
+        if any(values[i] > glove.threshold(i) for i in range(5)):
+            return True
+    return False
+
+def get_calibration(hand=PRIMARY_HAND):
+    """某隻手的 PressureCalibration；沒有手套或沒有校正時回傳 None"""
+    glove = gloves.get(hand)
+    return glove.calibration if glove is not None else None
+
+def force_to_level(pressure):
+    """沒有校正時的固定換算：cN → 0~1（PRESS_THRESHOLD 為 0，FULL_VOLUME_CN 為 1）"""
+    return min(1.0, max(0.0, (pressure - PRESS_THRESHOLD) / (FULL_VOLUME_CN - PRESS_THRESHOLD)))
+
+def get_normalized_pressure(index, hand=PRIMARY_HAND):
+    """0~1 的壓力；沒有校正時退回固定換算"""
+    calibration = get_calibration(hand)
+    pressure = get_finger_pressure(index, hand)
+    if calibration is None:
+        return force_to_level(pressure)
+    return calibration.normalize(index, pressure)
+
+def get_sample_times(hand=PRIMARY_HAND):
+    """取得某隻手最新一筆壓力資料的 (ADC 轉換時間, 序列埠收到時間)"""
+    glove = gloves.get(hand)
+    return glove.sample_times if glove is not None else (None, None)
 
 def update_finger_pressures():
     """這是保留給相容舊版的主程式用的，不需要做任何事"""
     pass
-
-# 啟動背景讀取 thread
-if ser is not None:
-    thread = threading.Thread(target=read_serial_loop, daemon=True)
-    thread.start()
@@ -0,0 +1,177 @@
+# sampled_instrument.py
+import mmap
+import os
+import re
+import struct
+
+import numpy as np
+
+from new_sound_manager import note_to_midi, SAMPLE_RATE
+
+# 每個 sample 開頭解碼放在 RAM 的長度（秒），其餘部分直接從 mmap（page cache）讀
+HEAD_SECONDS = 0.25
+
+# 檔名格式：C4_v64.wav、A#3_v100.wav（沒有 _v 則視為 velocity 127）
+_WAV_NAME = re.compile(r"^([A-G]#?)(\d)(?:_v(\d+))?\.wav$", re.IGNORECASE)
+
+
+def _map_file(path):
+    with open(path, "rb") as f:
+        return mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+
+def _riff_chunks(mm, start, end):
+    """逐一列出 RIFF chunk：(id, data_offset, size)"""
+    pos = start
+    while pos + 8 <= end:
+        chunk_id, size = struct.unpack_from("<4sI", mm, pos)
+        yield chunk_id, pos + 8, size
+        pos += 8 + size + (size & 1)
+
+
+class SampleZone:
+    """
+    一個 sample：開頭 head 已解碼成 float32 放在 RAM，
+    尾巴 tail 是對 mmap 的 numpy view，讀到時才由 page cache 提供、即時轉成 float32。
+    """
+
+    def __init__(self, data, scale, midi, velocity, sample_rate, head_frames):
+        self.midi = midi
+        self.velocity = velocity
+        self.sample_rate = sample_rate
+        self.length = len(data)
+        self.scale = scale
+        head_frames = min(head_frames, self.length)
+        self.head = data[:head_frames].astype(np.float32) * scale
+        self.tail = data[head_frames:]
+
+    def slice(self, start, stop):
+        """取出 [start, stop) 的 float32 sample，超出結尾的部分補 0"""
+        out = np.zeros(stop - start, dtype=np.float32)
+        head_len = len(self.head)
+        if start < head_len:
+            n = min(stop, head_len) - start
+            out[:n] = self.head[start:start + n]
+        t0 = max(start, head_len) - head_len
+        t1 = min(stop, self.length) - head_len
+        if t1 > t0:
+            offset = t0 + head_len - start
+            out[offset:offset + (t1 - t0)] = self.tail[t0:t1] * self.scale
+        return out
+
+
+def _load_wav(path, midi, velocity, head_seconds):
+    mm = _map_file(path)
+    riff, _, wave = struct.unpack_from("<4sI4s", mm, 0)
+    if riff != b"RIFF" or wave != b"WAVE":
+        raise ValueError(f"{path} 不是 WAV 檔")
+
+    fmt = None
+    data_offset = data_size = None
+    for chunk_id, offset, size in _riff_chunks(mm, 12, len(mm)):
+        if chunk_id == b"fmt ":
+            fmt = struct.unpack_from("<HHIIHH", mm, offset)
+        elif chunk_id == b"data":
+            data_offset, data_size = offset, min(size, len(mm) - offset)
+    if fmt is None or data_offset is None:
+        raise ValueError(f"{path} 缺少 fmt 或 data chunk")
+
+    audio_format, channels, sample_rate, _, _, bits = fmt
+    if audio_format == 1 and bits == 16:
+        dtype, scale = np.dtype("<i2"), 1.0 / 32768.0
+    elif audio_format == 3 and bits == 32:
+        dtype, scale = np.dtype("<f4"), 1.0
+    else:
+        raise ValueError(f"{path}：只支援 16-bit PCM 或 32-bit float WAV")
+
+    frames = data_size // (dtype.itemsize * channels)
+    data = np.frombuffer(mm, dtype=dtype, count=frames * channels, offset=data_offset)
+    data = data.reshape(frames, channels)[:, 0]  # 多聲道只取第一軌，仍是 mmap 上的 view
+    return SampleZone(data, scale, midi, velocity, sample_rate, int(head_seconds * sample_rate))
+
+
+def _load_sf2(path, head_seconds):
+    """
+    只讀 SF2 的 sample 資料（sdta/smpl）與 sample header（pdta/shdr），
+    每個 sample 依 originalPitch 當作一個 zone；preset / instrument 層的 velocity 分層不解析。
+    """
+    mm = _map_file(path)
+    smpl = shdr = None
+    for chunk_id, offset, size in _riff_chunks(mm, 12, len(mm)):
+        if chunk_id != b"LIST":
+            continue
+        list_type = mm[offset:offset + 4]
+        for sub_id, sub_offset, sub_size in _riff_chunks(mm, offset + 4, offset + size):
+            if list_type == b"sdta" and sub_id == b"smpl":
+                smpl = np.frombuffer(mm, dtype="<i2", count=sub_size // 2, offset=sub_offset)
+            elif list_type == b"pdta" and sub_id == b"shdr":
+                shdr = (sub_offset, sub_size)
+    if smpl is None or shdr is None:
+        raise ValueError(f"{path} 缺少 smpl 或 shdr chunk")
+
+    zones = []
+    offset, size = shdr
+    for i in range(size // 46 - 1):  # 最後一筆是 EOS 結尾記錄
+        name, start, end, _, _, rate, pitch, _, _, sample_type = struct.unpack_from(
+            "<20sIIIIIBbHH", mm, offset + i * 46)
+        if sample_type & 0x8000 or end <= start:  # ROM sample 或空 sample
+            continue
+        zones.append(SampleZone(smpl[start:end], 1.0 / 32768.0, pitch, 127, rate,
+                                int(head_seconds * rate)))
+    return zones
+
+
+class SampledInstrument:
+    """
+    多重取樣鋼琴音色。音符對應到音高最接近的 sample，再依按下的力道（velocity）選最接近的分層，
+    以線性內插 resample 到目標音高；內插以 numpy 向量運算一次處理整個 block。
+    分層之間不做 crossfade：每個 voice 只播一個分層。
+    """
+
+    def __init__(self, source, head_seconds=HEAD_SECONDS, output_rate=SAMPLE_RATE):
+        self.output_rate = output_rate
+        self.zones = []
+        if os.path.isdir(source):
+            for name in sorted(os.listdir(source)):
+                match = _WAV_NAME.match(name)
+                if not match:
+                    continue
+                key, octave, velocity = match.groups()
+                midi = note_to_midi(f"{key.upper()}{octave}")
+                velocity = int(velocity) if velocity else 127
+                self.zones.append(_load_wav(os.path.join(source, name), midi, velocity, head_seconds))
+        elif source.lower().endswith(".sf2"):
+            self.zones = _load_sf2(source, head_seconds)
+        else:
+            raise ValueError("sample 來源必須是 WAV 資料夾或 .sf2 檔（FLAC 請先轉成 WAV 才能 mmap）")
+        if not self.zones:
+            raise ValueError(f"{source} 裡沒有可用的 sample")
+        head_bytes = sum(zone.head.nbytes for zone in self.zones)
+        print(f"✅ 載入 {len(self.zones)} 個 sample zone，常駐 RAM {head_bytes / 1e6:.1f} MB")
+
+    def layers_for(self, note):
+        """
+        音高最接近的 sample 的所有 velocity 分層，依 velocity 排序：[(velocity, zone, step)]，
+        step 為每個輸出 sample 在 zone 上前進的距離
+        """
+        midi = note_to_midi(note)
+        nearest = min(self.zones, key=lambda z: abs(z.midi - midi)).midi
+        layers = [(zone.velocity, zone, 2 ** ((midi - zone.midi) / 12) * zone.sample_rate / self.output_rate)
+                  for zone in self.zones if zone.midi == nearest]
+        return sorted(layers, key=lambda layer: layer[0])
+
+    @staticmethod
+    def pick_layer(layers, velocity):
+        """從 layers_for 的結果選 velocity 最接近的分層，回傳 (zone, step)"""
+        _, zone, step = min(layers, key=lambda layer: abs(layer[0] - velocity))
+        return zone, step
+
+    def render(self, zone, step, pos, frames):
+        """從 zone 的 pos（浮點位置）開始產生 frames 個 sample，回傳 (chunk, new_pos)"""
+        positions = pos + step * np.arange(frames, dtype=np.float64)
+        base = int(positions[0])
+        idx = positions.astype(np.int64) - base
+        frac = (positions - np.floor(positions)).astype(np.float32)
+        segment = zone.slice(base, base + int(idx[-1]) + 2)
+        chunk = segment[idx] + frac * (segment[idx + 1] - segment[idx])
+        return chunk, pos + step * frames
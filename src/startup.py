@@ -0,0 +1,115 @@
+# startup.py
+import threading
+import time
+from concurrent.futures import Future, ThreadPoolExecutor
+
+from trace_events import span
+
+
+class StartupGraph:
+    """
+    啟動流程的相依圖：每個步驟宣告它依賴哪些步驟，沒有相依關係的步驟同時執行。
+    步驟函式會收到相依步驟的結果（依 deps 順序）作為參數。
+    步驟要等相依步驟都完成才送進 thread pool，pool 裡的 worker 不會卡在等待其他步驟上。
+    """
+
+    def __init__(self, max_workers=6):
+        self._pool = ThreadPoolExecutor(max_workers=max_workers, thread_name_prefix="startup")
+        self._futures = {}
+        self._cleanups = {}  # name → cleanup(result)，啟動失敗時收掉已完成的步驟
+        self._aborted = False
+        self.timings = {}  # name → (開始, 結束)，perf_counter 秒
+
+    def add(self, name, fn, deps=(), cleanup=None):
+        future = Future()
+        self._futures[name] = future
+        if cleanup is not None:
+            self._cleanups[name] = cleanup
+        deps = [self._futures[d] for d in deps]
+        remaining = [len(deps)]
+        lock = threading.Lock()
+
+        def dep_done(_):
+            with lock:
+                remaining[0] -= 1
+                if remaining[0]:
+                    return
+            self._start(name, fn, deps, future)
+
+        if not deps:
+            self._start(name, fn, deps, future)
+        for dep in deps:
+            dep.add_done_callback(dep_done)
+        return future
+
+    def _start(self, name, fn, deps, future):
+        for dep in deps:
+            if dep.cancelled():
+                future.cancel()
+                return
+            if dep.exception() is not None:
+                # 相依步驟失敗：這一步不執行，直接帶著同一個例外結束
+                if future.set_running_or_notify_cancel():
+                    future.set_exception(dep.exception())
+                return
+        try:
+            self._pool.submit(self._run, name, fn, [dep.result() for dep in deps], future)
+        except RuntimeError:
+            # pool 已經 shutdown（啟動中止），不再開始新的步驟
+            future.cancel()
+
+    def _run(self, name, fn, args, future):
+        if not future.set_running_or_notify_cancel():
+            return
+        start = time.perf_counter()
+        try:
+            with span(f"startup:{name}"):
+                result = fn(*args)
+        except BaseException as e:
+            self.timings[name] = (start, time.perf_counter())
+            future.set_exception(e)
+        else:
+            self.timings[name] = (start, time.perf_counter())
+            future.set_result(result)
+
+    def result(self, name):
+        """等待某個步驟完成並取得結果；步驟丟出的例外會先收掉其他步驟，再在這裡重新丟出"""
+        try:
+            return self._futures[name].result()
+        except BaseException:
+            self.abort()
+            raise
+
+    def done(self, name):
+        return self._futures[name].done()
+
+    def shutdown(self):
+        self._pool.shutdown(wait=False, cancel_futures=True)
+        for future in self._futures.values():
+            future.cancel()  # 還沒開始的步驟不再執行
+
+    def abort(self):
+        """啟動中止：不再開始新步驟，已完成（以及執行中、之後才完成）的步驟交給各自的 cleanup 收掉"""
+        if self._aborted:
+            return
+        self._aborted = True
+        self.shutdown()
+        for name, cleanup in self._cleanups.items():
+            self._futures[name].add_done_callback(lambda future, name=name, cleanup=cleanup:
+                                                  self._cleanup(name, cleanup, future))
+
+    @staticmethod
+    def _cleanup(name, cleanup, future):
+        if future.cancelled() or future.exception() is not None:
+            return
+        try:
+            cleanup(future.result())
+        except Exception as e:
+            print(f"⚠️ 收掉啟動步驟 {name} 失敗：{e}")
+
+    def report(self, t0):
+        """印出每個步驟相對於 t0 的起訖時間"""
+        print("\n⏱️ 啟動時間軸（ms）")
+        for name, (start, end) in sorted(self.timings.items(), key=lambda item: item[1][0]):
+            print(f"  {name:<12}{(start - t0) * 1000:>8.0f} → {(end - t0) * 1000:>6.0f}"
+                  f"  ({(end - start) * 1000:.0f})")
@@ -0,0 +1,131 @@
+# trace_events.py
+import atexit
+import collections
+import contextlib
+import functools
+import json
+import os
+import threading
+import time
+
+RING_SIZE = 65536        # 每個 thread 的 ring buffer 大小（事件數）
+MAX_EVENTS = 2000000     # 輸出檔最多保留的事件數
+FLUSH_INTERVAL = 0.5     # 背景 flush 週期（秒）
+
+_enabled = False
+_output_path = None
+_local = threading.local()
+_buffers = []            # [(tid, thread_name, deque)]
+_buffers_lock = threading.Lock()
+_collected = collections.deque(maxlen=MAX_EVENTS)
+_flusher = None
+_pid = os.getpid()
+
+
+def _buffer():
+    """取得目前 thread 的 ring buffer；第一次呼叫時登記"""
+    buf = getattr(_local, "buffer", None)
+    if buf is None:
+        buf = collections.deque(maxlen=RING_SIZE)
+        _local.buffer = buf
+        thread = threading.current_thread()
+        with _buffers_lock:
+            _buffers.append((threading.get_ident(), thread.name, buf))
+    return buf
+
+
+def _now_us():
+    return time.perf_counter_ns() // 1000
+
+
+@contextlib.contextmanager
+def _span(name):
+    buf = _buffer()
+    buf.append(("B", name, _now_us()))
+    try:
+        yield
+    finally:
+        buf.append(("E", name, _now_us()))
+
+
+def span(name):
+    """with span("名稱"): ... 記錄一段 begin/end；未啟用時幾乎沒有成本"""
+    if not _enabled:
+        return contextlib.nullcontext()
+    return _span(name)
+
+
+def traced(name=None):
+    """函式 decorator，把整個呼叫記成一段 span"""
+    def decorator(func):
+        label = name or func.__name__
+
+        @functools.wraps(func)
+        def wrapper(*args, **kwargs):
+            if not _enabled:
+                return func(*args, **kwargs)
+            buf = _buffer()
+            buf.append(("B", label, _now_us()))
+            try:
+                return func(*args, **kwargs)
+            finally:
+                buf.append(("E", label, _now_us()))
+        return wrapper
+    return decorator
+
+
+def instant(name):
+    if _enabled:
+        _buffer().append(("i", name, _now_us()))
+
+
+def _drain():
+    with _buffers_lock:
+        buffers = list(_buffers)
+    for tid, _, buf in buffers:
+        while True:
+            try:
+                ph, name, ts = buf.popleft()
+            except IndexError:
+                break
+            _collected.append((tid, ph, name, ts))
+
+
+def _flush_loop():
+    while _enabled:
+        time.sleep(FLUSH_INTERVAL)
+        _drain()
+
+
+def enable(path="trace.json"):
+    """開始記錄；結束時把 Chrome trace-event JSON 寫到 path（可直接用 Perfetto UI 或 chrome://tracing 開啟）"""
+    global _enabled, _output_path, _flusher
+    _output_path = path
+    _enabled = True
+    _flusher = threading.Thread(target=_flush_loop, daemon=True, name="trace_flush")
+    _flusher.start()
+    atexit.register(write)
+
+
+def write():
+    global _enabled, _output_path
+    if _output_path is None:
+        return
+    _enabled = False
+    _drain()
+
+    events = []
+    with _buffers_lock:
+        for tid, thread_name, _ in _buffers:
+            events.append({"ph": "M", "name": "thread_name", "pid": _pid, "tid": tid,
+                           "args": {"name": thread_name}})
+    for tid, ph, name, ts in _collected:
+        event = {"ph": ph, "name": name, "pid": _pid, "tid": tid, "ts": ts}
+        if ph == "i":
+            event["s"] = "t"
+        events.append(event)
+
+    with open(_output_path, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ms"}, f)
+    print(f"🧵 trace 已寫入 {_output_path}（{len(_collected)} 個事件）")
+    _output_path = None